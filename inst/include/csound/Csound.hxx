@@ -37,6 +37,8 @@
 #else
 #include <boost/lockfree/queue.hpp>
 #endif
+#include <atomic>
+#include <cstdio>
 #include <cstring>
 #include <string>
 #include <string.h>
@@ -77,6 +79,22 @@ struct ArgParser {
     }
 };
 
+/**
+ * Event log file layout, in native byte order:
+ * a header of the 8 byte magic "CSEVLOG1", a uint32_t version, and
+ * a uint32_t sizeof(MYFLT); then one record per event, made of the
+ * uint64_t k-cycle index before which the event was applied, a uint8_t
+ * record type, and the body written by CsoundThreadEvent::write().
+ */
+static const char csound_event_log_magic[8] = {'C','S','E','V','L','O','G','1'};
+static const uint32_t csound_event_log_version = 2;
+
+enum {
+    CSOUND_EVENT_LOG_SCORE_EVENT = 'e',
+    CSOUND_EVENT_LOG_SCORE = 's',
+    CSOUND_EVENT_LOG_CONTROL_CHANNEL = 'c'
+};
+
 struct CsoundThreadEvent {
     CsoundThreadEvent()
     {
@@ -88,22 +106,45 @@ struct CsoundThreadEvent {
     {
         return -1;
     }
+    /**
+     * Writes the record type and body of this event to an event log.
+     * Returns 0 on success, or -1 if the event cannot be logged.
+     */
+    virtual int write(FILE *) const
+    {
+        return -1;
+    }
 };
 
 struct CsoundThreadEventScoreEvent : CsoundThreadEvent {
     char opcode;
     std::vector<MYFLT> pfields;
-    CsoundThreadEventScoreEvent(char opcode_, MYFLT *pfields_, int pfield_count)
+    CsoundThreadEventScoreEvent(char opcode_, const MYFLT *pfields_, int pfield_count)
     {
         opcode = opcode_;
-        for (int i = 0; i < pfield_count; ++pfield_count) {
-            pfields.push_back(pfields[i]);
+        for (int i = 0; i < pfield_count; ++i) {
+            pfields.push_back(pfields_[i]);
         }
     }
     virtual int operator()(CSOUND *csound)
     {
         return csoundScoreEvent(csound, opcode, pfields.data(), pfields.size());
     }
+    virtual int write(FILE *file) const
+    {
+        uint8_t type = CSOUND_EVENT_LOG_SCORE_EVENT;
+        uint8_t opcode_ = (uint8_t) opcode;
+        uint32_t count = (uint32_t) pfields.size();
+        if (std::fwrite(&type, sizeof(type), 1, file) != 1 ||
+            std::fwrite(&opcode_, sizeof(opcode_), 1, file) != 1 ||
+            std::fwrite(&count, sizeof(count), 1, file) != 1) {
+            return -1;
+        }
+        if (count && std::fwrite(pfields.data(), sizeof(MYFLT), count, file) != count) {
+            return -1;
+        }
+        return 0;
+    }
 };
 
 struct CsoundThreadEventScore : CsoundThreadEvent {
@@ -116,8 +157,103 @@ struct CsoundThreadEventScore : CsoundThreadEvent {
     {
         return csoundReadScore(csound, score.c_str());
     }
+    virtual int write(FILE *file) const
+    {
+        uint8_t type = CSOUND_EVENT_LOG_SCORE;
+        uint32_t length = (uint32_t) score.size();
+        if (std::fwrite(&type, sizeof(type), 1, file) != 1 ||
+            std::fwrite(&length, sizeof(length), 1, file) != 1) {
+            return -1;
+        }
+        if (length && std::fwrite(score.data(), 1, length, file) != length) {
+            return -1;
+        }
+        return 0;
+    }
+};
+
+struct CsoundThreadEventControlChannel : CsoundThreadEvent {
+    std::string name;
+    MYFLT value;
+    CsoundThreadEventControlChannel(std::string name_, MYFLT value_)
+    {
+        name = name_;
+        value = value_;
+    }
+    virtual int operator()(CSOUND *csound)
+    {
+        csoundSetControlChannel(csound, name.c_str(), value);
+        return 0;
+    }
+    virtual int write(FILE *file) const
+    {
+        uint8_t type = CSOUND_EVENT_LOG_CONTROL_CHANNEL;
+        uint32_t length = (uint32_t) name.size();
+        if (std::fwrite(&type, sizeof(type), 1, file) != 1 ||
+            std::fwrite(&length, sizeof(length), 1, file) != 1) {
+            return -1;
+        }
+        if (length && std::fwrite(name.data(), 1, length, file) != length) {
+            return -1;
+        }
+        if (std::fwrite(&value, sizeof(value), 1, file) != 1) {
+            return -1;
+        }
+        return 0;
+    }
 };
 
+/**
+ * Reads the next record of an event log, returning the event and
+ * setting its k-cycle index, or returning 0 at the end of the log.
+ */
+inline CsoundThreadEvent *readCsoundThreadEvent(FILE *file, uint64_t &kcycle)
+{
+    uint8_t type = 0;
+    if (std::fread(&kcycle, sizeof(kcycle), 1, file) != 1 ||
+        std::fread(&type, sizeof(type), 1, file) != 1) {
+        return 0;
+    }
+    if (type == CSOUND_EVENT_LOG_SCORE_EVENT) {
+        uint8_t opcode = 0;
+        uint32_t count = 0;
+        if (std::fread(&opcode, sizeof(opcode), 1, file) != 1 ||
+            std::fread(&count, sizeof(count), 1, file) != 1) {
+            return 0;
+        }
+        std::vector<MYFLT> pfields(count);
+        if (count && std::fread(pfields.data(), sizeof(MYFLT), count, file) != count) {
+            return 0;
+        }
+        return new CsoundThreadEventScoreEvent((char) opcode, pfields.data(), (int) count);
+    }
+    if (type == CSOUND_EVENT_LOG_SCORE) {
+        uint32_t length = 0;
+        if (std::fread(&length, sizeof(length), 1, file) != 1) {
+            return 0;
+        }
+        std::string score(length, '\0');
+        if (length && std::fread(&score[0], 1, length, file) != length) {
+            return 0;
+        }
+        return new CsoundThreadEventScore(score);
+    }
+    if (type == CSOUND_EVENT_LOG_CONTROL_CHANNEL) {
+        uint32_t length = 0;
+        if (std::fread(&length, sizeof(length), 1, file) != 1) {
+            return 0;
+        }
+        std::string name(length, '\0');
+        MYFLT value = 0;
+        if ((length && std::fread(&name[0], 1, length, file) != length) ||
+            std::fread(&value, sizeof(value), 1, file) != 1) {
+            return 0;
+        }
+        return new CsoundThreadEventControlChannel(name, value);
+    }
+    return 0;
+}
+
 /**
  * This C++ header file only library declares and defines all native
  * functionality for the JavaScript Csound APIs.  This library can of course
@@ -138,15 +274,19 @@ protected:
 #if defined(_MSC_VER)
     concurrency::concurrent_queue<CsoundThreadEvent *> csound_event_queue;
 #else
-    boost::lockfree::queue<CsoundThreadEvent *, boost::lockfree::fixed_sized<false> > csound_event_queue(0);
+    boost::lockfree::queue<CsoundThreadEvent *, boost::lockfree::fixed_sized<false> > csound_event_queue{0};
 #endif
     std::thread *performance_thread;
+    FILE *event_log;
+    std::atomic<bool> is_logging;
+    uint64_t kcycle;
 public:
     virtual ~CSound();
     CSound();
     virtual int compileCsd(std::string pathname);
     virtual int compileCsdText(std::string csd);
     virtual int compileOrc(std::string orc);
+    virtual void closeEventLog();
     virtual CSOUND *create();
     virtual CSOUND *create(void *userdata);
     virtual void destroy();
@@ -173,11 +313,13 @@ public:
     virtual std::thread *perform();
     virtual int performanceThreadRoutine();
     virtual void readScore(std::string score);
+    virtual int replayEventLog(std::string pathname);
     virtual void rewindScore();
     virtual int runUtility(std::string command);
     virtual void scoreEvent(char opcode, MYFLT *pfields, int pfield_count);
     virtual void setCsound(CSOUND *csound);
     virtual void setControlChannel(std::string name, MYFLT value);
+    virtual int setEventLog(std::string pathname);
     virtual int setGlobalEnv(std::string name, std::string value);
     virtual void setInput(std::string name);
     virtual int setOption(std::string token);
@@ -199,17 +341,27 @@ inline int CSound::performanceThreadRoutine()
     is_running = 1;
     int is_finished = 0;
     CsoundThreadEvent *event = 0;
+    kcycle = 0;
     while((is_running == 1) && (is_finished == 0)) {
 #if defined(_MSC_VER)
         while (csound_event_queue.try_pop(event)) {
 #else
         while (csound_event_queue.pop(event)) {
 #endif
+            if (event_log) {
+                if (std::fwrite(&kcycle, sizeof(kcycle), 1, event_log) != 1 ||
+                    event->write(event_log) != 0) {
+                    csoundMessage(csound, "Failed to write the event log, closing it.\n");
+                    closeEventLog();
+                }
+            }
             (*event)(csound);
             delete event;
         }
         is_finished = csoundPerformKsmps(csound);
+        kcycle++;
     }
+    closeEventLog();
     int result = csoundCleanup(csound);
     csoundReset(csound);
 #if defined(_MSC_VER)
@@ -227,10 +379,19 @@ inline CSound::~CSound()
     destroy();
 }
 
-inline CSound::CSound() : csound(0), performance_thread(0), is_running(0)
+inline CSound::CSound() : csound(0), is_running(0), performance_thread(0), event_log(0), is_logging(false), kcycle(0)
 {
 }
 
+inline void CSound::closeEventLog()
+{
+    is_logging = false;
+    if (event_log) {
+        std::fclose(event_log);
+        event_log = 0;
+    }
+}
+
 inline int CSound::compileCsd(std::string pathname)
 {
     return csoundCompileCsd(csound, const_cast<char *>(pathname.c_str()));
@@ -388,6 +549,51 @@ inline void CSound::readScore(std::string score)
     csound_event_queue.push(new CsoundThreadEventScore(score));
 }
 
+/**
+ * Performs, on the calling thread and as fast as possible, an event log
+ * written by a previous performance: each logged event is applied before
+ * the same k-cycle as it was originally, and performance then continues
+ * to the end of the score. Csound must be compiled and started with the
+ * same orchestra and options as the logged performance, and should
+ * render to a file or to no output. Returns the csoundCleanup() result,
+ * or -1 if the log cannot be read.
+ */
+inline int CSound::replayEventLog(std::string pathname)
+{
+    FILE *file = std::fopen(pathname.c_str(), "rb");
+    if (!file) {
+        return -1;
+    }
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t myflt_size = 0;
+    if (std::fread(magic, sizeof(magic), 1, file) != 1 ||
+        std::memcmp(magic, csound_event_log_magic, sizeof(magic)) != 0 ||
+        std::fread(&version, sizeof(version), 1, file) != 1 ||
+        version < 1 || version > csound_event_log_version ||
+        std::fread(&myflt_size, sizeof(myflt_size), 1, file) != 1 ||
+        myflt_size != sizeof(MYFLT)) {
+        std::fclose(file);
+        return -1;
+    }
+    uint64_t replay_kcycle = 0;
+    uint64_t event_kcycle = 0;
+    int is_finished = 0;
+    CsoundThreadEvent *event = readCsoundThreadEvent(file, event_kcycle);
+    while (is_finished == 0) {
+        while (event && event_kcycle <= replay_kcycle) {
+            (*event)(csound);
+            delete event;
+            event = readCsoundThreadEvent(file, event_kcycle);
+        }
+        is_finished = csoundPerformKsmps(csound);
+        replay_kcycle++;
+    }
+    delete event;
+    std::fclose(file);
+    return csoundCleanup(csound);
+}
+
 inline void CSound::rewindScore()
 {
     csoundRewindScore(csound);
@@ -409,9 +615,46 @@ inline void CSound::setCsound(CSOUND *csound_)
     csound = csound_;
 }
 
+/**
+ * Sets the value of a control channel. While an event log is open, the
+ * value is sent through the event queue instead, so that it is logged
+ * with, and replayed before, the same k-cycle as it is applied.
+ */
 inline void CSound::setControlChannel(std::string name, MYFLT value)
 {
-    csoundSetControlChannel(csound, name.c_str(), value);
+    if (is_logging) {
+        csound_event_queue.push(new CsoundThreadEventControlChannel(name, value));
+    } else {
+        csoundSetControlChannel(csound, name.c_str(), value);
+    }
+}
+
+/**
+ * Starts logging every event sent through readScore(), scoreEvent(), and
+ * setControlChannel(), with the k-cycle index before which it is applied,
+ * to a compact binary file that replayEventLog() can perform offline.
+ * Call before perform(); the log is closed when the performance ends.
+ * An empty pathname closes the current log. Returns 0 on success.
+ */
+inline int CSound::setEventLog(std::string pathname)
+{
+    closeEventLog();
+    if (pathname.empty()) {
+        return 0;
+    }
+    event_log = std::fopen(pathname.c_str(), "wb");
+    if (!event_log) {
+        return -1;
+    }
+    uint32_t myflt_size = sizeof(MYFLT);
+    if (std::fwrite(csound_event_log_magic, sizeof(csound_event_log_magic), 1, event_log) != 1 ||
+        std::fwrite(&csound_event_log_version, sizeof(csound_event_log_version), 1, event_log) != 1 ||
+        std::fwrite(&myflt_size, sizeof(myflt_size), 1, event_log) != 1) {
+        closeEventLog();
+        return -1;
+    }
+    is_logging = true;
+    return 0;
 }
 
 inline int CSound::setGlobalEnv(std::string name, std::string value)
@@ -0,0 +1,236 @@
+/*
+    csCircularBufferAudio.hpp:
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+#ifndef CSOUND_CSCIRCULARBUFFERAUDIO_HPP
+#define CSOUND_CSCIRCULARBUFFERAUDIO_HPP
+
+#ifndef SWIG
+#include "csound.hpp"
+#include <atomic>
+#endif
+
+#if defined(__cplusplus)
+
+/**
+ * CsoundCircularBufferAudio(Csound *, int capacityFrames)
+ * CsoundCircularBufferAudio(CSOUND *, int capacityFrames)
+ *
+ * A host implemented real-time audio output that writes each block
+ * rendered by Csound into a Csound circular buffer, so that consumers
+ * outside the audio thread (R, an analysis worker, a socket server...)
+ * can read the audio at their own pace without locks and without ever
+ * blocking the engine.
+ *
+ * The constructor must be called between csoundCreate() and the start
+ * of performance; it enables host implemented audio and installs the
+ * play open, play, and close callbacks. Csound must then be run with
+ * real-time output ("-odac"). The ring buffer is created when Csound
+ * first opens the output, with room for capacityFrames sample frames,
+ * and is kept until the object is destroyed, so that it is never freed
+ * under a reader; if Csound opens the output again, the same ring is
+ * reused, and opening it with a different number of channels fails.
+ *
+ * Exactly one thread may call Read(). When the consumer falls behind
+ * and the ring is full, whole frames that do not fit are dropped and
+ * counted as an overrun, so latency never exceeds the ring capacity.
+ * The object must outlive the performance.
+ */
+class CsoundCircularBufferAudio {
+ protected:
+    CSOUND  *csound;
+    std::atomic<void *> buffer;
+    int     capacityFrames;
+    int     nchnls;
+    double  sampleRate;
+    std::atomic<unsigned long long> samplesWritten;
+    std::atomic<unsigned long long> samplesRead;
+    std::atomic<unsigned long long> overruns;
+    std::atomic<unsigned long long> samplesDropped;
+    static CsoundCircularBufferAudio *FromCsound(CSOUND *csound)
+    {
+      return (CsoundCircularBufferAudio *) *csoundGetRtPlayUserData(csound);
+    }
+    static int playopenCallback(CSOUND *csound, const csRtAudioParams *parm)
+    {
+      CsoundCircularBufferAudio *self = FromCsound(csound);
+      if (!self || parm->nChannels <= 0)
+        return CSOUND_ERROR;
+      if (self->buffer.load())
+        return parm->nChannels == self->nchnls ? 0 : CSOUND_ERROR;
+      self->nchnls = parm->nChannels;
+      self->sampleRate = parm->sampleRate;
+      self->samplesWritten = 0;
+      self->samplesRead = 0;
+      self->ResetCounters();
+      // Published last, so that a reader that sees the ring also sees
+      // nchnls and the counters.
+      self->buffer =
+        csoundCreateCircularBuffer(csound,
+                                   self->capacityFrames * self->nchnls + 1,
+                                   (int) sizeof(MYFLT));
+      return self->buffer.load() ? 0 : CSOUND_MEMORY;
+    }
+    static void rtplayCallback(CSOUND *csound, const MYFLT *outBuf,
+                               int nbytes)
+    {
+      CsoundCircularBufferAudio *self = FromCsound(csound);
+      void *buffer_ = self ? self->buffer.load() : 0;
+      if (!buffer_)
+        return;
+      int items = nbytes / (int) sizeof(MYFLT);
+      // Only this thread adds to the ring, so the free space computed
+      // here can only grow before the write below.
+      int space = (int) (self->GetCapacity() - self->GetFillLevel());
+      space -= space % self->nchnls;
+      int toWrite = items < space ? items : space;
+      int written = 0;
+      if (toWrite > 0)
+        written = csoundWriteCircularBuffer(csound, buffer_,
+                                            outBuf, toWrite);
+      self->samplesWritten += (unsigned long long) written;
+      if (written < items) {
+        self->overruns++;
+        self->samplesDropped += (unsigned long long) (items - written);
+      }
+    }
+    static void rtcloseCallback(CSOUND *csound)
+    {
+      // The ring is kept so that readers can drain what is left.
+      (void) csound;
+    }
+    void Attach()
+    {
+      csoundSetHostImplementedAudioIO(csound, 1, 0);
+      *csoundGetRtPlayUserData(csound) = (void *) this;
+      csoundSetPlayopenCallback(csound, playopenCallback);
+      csoundSetRtplayCallback(csound, rtplayCallback);
+      csoundSetRtcloseCallback(csound, rtcloseCallback);
+    }
+    void DestroyBuffer()
+    {
+      void *buffer_ = buffer.exchange(0);
+      if (buffer_)
+        csoundDestroyCircularBuffer(csound, buffer_);
+    }
+ public:
+    CSOUND *GetCsound()
+    {
+      return csound;
+    }
+    /**
+     * Returns the number of output channels, valid once Csound has
+     * opened the output.
+     */
+    int GetNchnls()
+    {
+      return nchnls;
+    }
+    double GetSampleRate()
+    {
+      return sampleRate;
+    }
+    /**
+     * Returns the capacity of the ring in samples (frames * nchnls).
+     */
+    size_t GetCapacity()
+    {
+      return (size_t) capacityFrames * nchnls;
+    }
+    /**
+     * Returns the number of samples currently waiting to be read.
+     */
+    size_t GetFillLevel()
+    {
+      return (size_t) (samplesWritten.load() - samplesRead.load());
+    }
+    /**
+     * Returns the number of blocks from which Csound had to drop frames
+     * because the ring was full.
+     */
+    unsigned long long GetOverrunCount()
+    {
+      return overruns.load();
+    }
+    /**
+     * Returns the total number of samples dropped by overruns.
+     */
+    unsigned long long GetDroppedSamples()
+    {
+      return samplesDropped.load();
+    }
+    /**
+     * Returns the total number of samples written into the ring.
+     */
+    unsigned long long GetWrittenSamples()
+    {
+      return samplesWritten.load();
+    }
+    /**
+     * Resets the overrun and dropped sample counters.
+     */
+    void ResetCounters()
+    {
+      overruns = 0;
+      samplesDropped = 0;
+    }
+    /**
+     * Reads at most 'items' samples of interleaved audio into 'out'
+     * without blocking, and returns the number of samples read. Ask for
+     * a multiple of GetNchnls() to stay frame aligned.
+     */
+    int Read(MYFLT *out, int items)
+    {
+      void *buffer_ = buffer.load();
+      if (!buffer_ || items <= 0)
+        return 0;
+      int read = csoundReadCircularBuffer(csound, buffer_, out, items);
+      samplesRead += (unsigned long long) read;
+      return read;
+    }
+    // --------
+    CsoundCircularBufferAudio(Csound *csound_, int capacityFrames_ = 8192)
+      : csound(csound_->GetCsound()), buffer(0),
+        capacityFrames(capacityFrames_), nchnls(0), sampleRate(0),
+        samplesWritten(0), samplesRead(0), overruns(0), samplesDropped(0)
+    {
+      Attach();
+    }
+    CsoundCircularBufferAudio(CSOUND *csound_, int capacityFrames_ = 8192)
+      : csound(csound_), buffer(0),
+        capacityFrames(capacityFrames_), nchnls(0), sampleRate(0),
+        samplesWritten(0), samplesRead(0), overruns(0), samplesDropped(0)
+    {
+      Attach();
+    }
+    ~CsoundCircularBufferAudio()
+    {
+      if (*csoundGetRtPlayUserData(csound) == (void *) this)
+        *csoundGetRtPlayUserData(csound) = 0;
+      DestroyBuffer();
+    }
+ private:
+    CsoundCircularBufferAudio(const CsoundCircularBufferAudio &);
+    CsoundCircularBufferAudio &operator=(const CsoundCircularBufferAudio &);
+};
+
+#endif  // __cplusplus
+
+#endif  // CSOUND_CSCIRCULARBUFFERAUDIO_HPP
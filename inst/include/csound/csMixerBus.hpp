@@ -0,0 +1,354 @@
+/*
+    csMixerBus.hpp:
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+#ifndef CSOUND_CSMIXERBUS_HPP
+#define CSOUND_CSMIXERBUS_HPP
+
+#ifdef SWIG
+%include <std_vector.i>
+#else
+#include "csound.hpp"
+#include <algorithm>
+#include <vector>
+#endif
+
+#if defined(__cplusplus)
+
+/**
+ * CsoundMixerBus
+ *
+ * Runs several independent Csound instances, each on its own thread, in
+ * lockstep, and sums their audio output into one output stream. This
+ * spreads a large realtime installation across cores, which the single
+ * k-loop of one instance cannot do.
+ *
+ * Every engine must already be compiled and started (csoundStart()), and
+ * should use host implemented audio (csoundSetHostImplementedAudioIO())
+ * so that it does not open its own audio device; all engines must have
+ * the same ksmps and nchnls. The bus itself does not open an audio device
+ * either; the host reads the mixed block with GetOutput() after each call
+ * to PerformKsmps(), or receives it in the process callback of Perform().
+ *
+ * For each block, the engine threads and the calling thread meet at a
+ * Csound thread barrier, every engine performs one k-period in parallel,
+ * and all threads meet again at a second barrier before the outputs
+ * are summed. Only the thread that calls Start() should call
+ * PerformKsmps(), Perform(), and Stop().
+
+  An example program using the CsoundMixerBus class
+
+#include "csound.hpp"
+#include "csMixerBus.hpp"
+
+int main(int argc, char *argv[])
+{
+  Csound a, b;
+  // ...set options, compile, and start both instances...
+  CsoundMixerBus bus;
+  bus.AddEngine(&a);
+  bus.AddEngine(&b);
+  if (bus.Start() == 0) {
+    while (bus.PerformKsmps() == 0) {
+      const MYFLT *mixed = bus.GetOutput();
+      // write GetKsmps() frames of GetNchnls() channels somewhere...
+    }
+    bus.Stop();
+  }
+  return 0;
+}
+*/
+
+class CsoundMixerBus {
+ protected:
+    struct EngineThreadData {
+      CsoundMixerBus *bus;
+      size_t index;
+    };
+    std::vector<CSOUND *> engines;
+    std::vector<MYFLT> gains;
+    std::vector<int> results;
+    std::vector<void *> threads;
+    std::vector<EngineThreadData> threadData;
+    std::vector<MYFLT> output;
+    void    *startBarrier;
+    void    *endBarrier;
+    void    *startMutex;
+    int     ksmps;
+    int     nchnls;
+    int     status;
+    volatile int running;
+    void (*processcallback)(void *cdata, const MYFLT *output,
+                            int frames, int channels);
+    void    *cdata;
+    static uintptr_t engineThreadRoutine(void *userdata)
+    {
+      EngineThreadData *data = (EngineThreadData *) userdata;
+      CsoundMixerBus *bus = data->bus;
+      size_t index = data->index;
+      // Start() holds startMutex until every thread has been created, and
+      // only then sets running; if it could not create them all, these
+      // threads exit here instead of blocking on a barrier that can never
+      // fill.
+      csoundLockMutex(bus->startMutex);
+      csoundUnlockMutex(bus->startMutex);
+      if (!bus->running)
+        return 0;
+      for (;;) {
+        csoundWaitBarrier(bus->startBarrier);
+        if (!bus->running)
+          break;
+        if (bus->results[index] == 0)
+          bus->results[index] = csoundPerformKsmps(bus->engines[index]);
+        csoundWaitBarrier(bus->endBarrier);
+      }
+      return 0;
+    }
+    void Mix()
+    {
+      size_t samples = output.size();
+      std::fill(output.begin(), output.end(), (MYFLT) 0);
+      for (size_t i = 0; i < engines.size(); i++) {
+        if (results[i] != 0)
+          continue;
+        const MYFLT *spout = csoundGetSpout(engines[i]);
+        MYFLT gain = gains[i];
+        for (size_t j = 0; j < samples; j++)
+          output[j] += spout[j] * gain;
+      }
+    }
+ public:
+    /**
+     * Adds a started Csound instance to the bus, and returns its index,
+     * or -1 if the bus is already running.
+     */
+    int AddEngine(CSOUND *csound)
+    {
+      if (running || !csound)
+        return -1;
+      engines.push_back(csound);
+      gains.push_back((MYFLT) 1);
+      results.push_back(0);
+      return (int) engines.size() - 1;
+    }
+    int AddEngine(Csound *csound)
+    {
+      return AddEngine(csound->GetCsound());
+    }
+    size_t GetEngineCount()
+    {
+      return engines.size();
+    }
+    CSOUND *GetEngine(size_t index)
+    {
+      return engines[index];
+    }
+    /**
+     * Sets the gain applied to an engine's output when it is summed
+     * into the bus (1 by default).
+     */
+    void SetGain(size_t index, MYFLT gain)
+    {
+      gains[index] = gain;
+    }
+    MYFLT GetGain(size_t index)
+    {
+      return gains[index];
+    }
+    /**
+     * Returns the result of the most recent csoundPerformKsmps() call of
+     * an engine: zero while it is playing, non-zero once it has finished.
+     * Finished engines are no longer performed or mixed.
+     */
+    int GetEngineStatus(size_t index)
+    {
+      return results[index];
+    }
+    int GetKsmps()
+    {
+      return ksmps;
+    }
+    int GetNchnls()
+    {
+      return nchnls;
+    }
+    /**
+     * Returns the current status, zero if still playing, positive if
+     * every engine has reached the end of its score or the bus was
+     * stopped, and negative if an error occured.
+     */
+    int GetStatus()
+    {
+      return status;
+    }
+    /**
+     * Returns the mixed output of the last block, ksmps frames of
+     * nchnls interleaved channels, in the same layout as spout.
+     */
+    const MYFLT *GetOutput()
+    {
+      return output.empty() ? (const MYFLT *) 0 : &output[0];
+    }
+    /**
+     * Sets a function that Perform() calls with the mixed output
+     * after each block.
+     */
+    void SetProcessCallback(void (*Callback)(void *, const MYFLT *, int, int),
+                            void *cbdata)
+    {
+      processcallback = Callback;
+      cdata = cbdata;
+    }
+    /**
+     * Creates the barriers and one performance thread per engine.
+     * Returns zero on success, or a negative value if there are no
+     * engines, the engines do not agree on ksmps and nchnls, or the
+     * threads could not be created.
+     */
+    int Start()
+    {
+      if (running)
+        return 0;
+      if (engines.empty())
+        return CSOUND_ERROR;
+      ksmps = (int) csoundGetKsmps(engines[0]);
+      nchnls = (int) csoundGetNchnls(engines[0]);
+      for (size_t i = 1; i < engines.size(); i++) {
+        if ((int) csoundGetKsmps(engines[i]) != ksmps ||
+            (int) csoundGetNchnls(engines[i]) != nchnls)
+          return CSOUND_ERROR;
+      }
+      output.assign((size_t) ksmps * nchnls, (MYFLT) 0);
+      std::fill(results.begin(), results.end(), 0);
+      startBarrier = csoundCreateBarrier((unsigned int) engines.size() + 1);
+      endBarrier = csoundCreateBarrier((unsigned int) engines.size() + 1);
+      startMutex = csoundCreateMutex(0);
+      if (!startBarrier || !endBarrier || !startMutex) {
+        Destroy();
+        return CSOUND_MEMORY;
+      }
+      status = 0;
+      threadData.resize(engines.size());
+      csoundLockMutex(startMutex);
+      for (size_t i = 0; i < engines.size(); i++) {
+        threadData[i].bus = this;
+        threadData[i].index = i;
+        void *thread = csoundCreateThread(engineThreadRoutine, &threadData[i]);
+        if (!thread) {
+          // Release the threads that were created while running is still
+          // zero, so that they exit, and wait for them before the barriers
+          // and the mutex are destroyed.
+          csoundUnlockMutex(startMutex);
+          for (size_t j = 0; j < threads.size(); j++)
+            csoundJoinThread(threads[j]);
+          threads.clear();
+          Destroy();
+          status = CSOUND_ERROR;
+          return CSOUND_ERROR;
+        }
+        threads.push_back(thread);
+      }
+      running = 1;
+      csoundUnlockMutex(startMutex);
+      return 0;
+    }
+    /**
+     * Performs one k-period on every engine in parallel and mixes their
+     * outputs. Returns zero while any engine is still playing, and the
+     * bus status otherwise.
+     */
+    int PerformKsmps()
+    {
+      if (!running)
+        return status ? status : 1;
+      csoundWaitBarrier(startBarrier);
+      csoundWaitBarrier(endBarrier);
+      Mix();
+      int playing = 0;
+      for (size_t i = 0; i < results.size(); i++) {
+        if (results[i] < 0) {
+          status = results[i];
+          return status;
+        }
+        if (results[i] == 0)
+          playing = 1;
+      }
+      if (!playing)
+        status = 1;
+      return status;
+    }
+    /**
+     * Performs until every engine has finished or an error occurs,
+     * calling the process callback, if any, after each block.
+     * Returns the final status.
+     */
+    int Perform()
+    {
+      while (PerformKsmps() == 0) {
+        if (processcallback)
+          processcallback(cdata, GetOutput(), ksmps, nchnls);
+      }
+      return status;
+    }
+    /**
+     * Stops the engine threads and waits for them to exit. The engines
+     * themselves are not cleaned up or destroyed.
+     */
+    void Stop()
+    {
+      if (running) {
+        running = 0;
+        csoundWaitBarrier(startBarrier);
+        for (size_t i = 0; i < threads.size(); i++)
+          csoundJoinThread(threads[i]);
+        threads.clear();
+        if (status == 0)
+          status = 1;
+      }
+      Destroy();
+    }
+    // --------
+    CsoundMixerBus() : startBarrier(0), endBarrier(0), startMutex(0),
+                       ksmps(0), nchnls(0),
+                       status(0), running(0), processcallback(0), cdata(0)
+    {
+    }
+    ~CsoundMixerBus()
+    {
+      Stop();
+    }
+ private:
+    void Destroy()
+    {
+      if (startBarrier)
+        csoundDestroyBarrier(startBarrier);
+      if (endBarrier)
+        csoundDestroyBarrier(endBarrier);
+      if (startMutex)
+        csoundDestroyMutex(startMutex);
+      startBarrier = 0;
+      endBarrier = 0;
+      startMutex = 0;
+    }
+};
+
+#endif  // __cplusplus
+
+#endif  // CSOUND_CSMIXERBUS_HPP
@@ -39,6 +39,8 @@
 %}
 #else
 #include "csound.h"
+#include <algorithm>
+#include <vector>
 #if defined(HAVE_PTHREAD_SPIN_LOCK) && !defined(SWIG)
 #include <pthread.h>
 #endif
@@ -104,6 +106,20 @@ class PUBLIC Csound
 {
 protected:
   CSOUND *csound;
+  // Serializes ScoreEvents() calls on this instance.
+  void *scoreEventsMutex;
+#ifndef SWIG
+  // Orders rows of a p-field matrix by start time (p2).
+  struct ScoreEventStartTimeLess
+  {
+    const MYFLT *pFields;
+    long stride;
+    bool operator()(long a, long b) const
+    {
+      return pFields[a * stride + 1] < pFields[b * stride + 1];
+    }
+  };
+#endif
 public:
   void *pydata;
 
@@ -526,6 +542,53 @@ public:
   {
     return csoundScoreEventAbsolute(csound, type, pFields, numFields, time_ofs);
   }
+#ifndef SWIG
+  /**
+   * Convenience loop that sends a matrix of score events. Event i has
+   * type types[i] and numFields p-fields starting at pFields[i * stride]
+   * (p1 first); a stride of 0 means the rows are packed. The events are
+   * stably sorted by start time (p2) and sent one at a time with
+   * csoundScoreEventAbsolute(), using the score time read once before
+   * the first event as their common origin, so that events with the same
+   * p2 start together. As with ScoreEvent(), start times are relative to
+   * the current performance time. This is no faster than calling
+   * ScoreEvent() for each event, and events sent by other threads through
+   * ScoreEvent() may be interleaved with these. Returns zero, or the
+   * first non-zero result of csoundScoreEventAbsolute().
+   * <p>
+   * This function is not virtual, so that adding it does not change the
+   * layout of the vtable.
+   */
+  int ScoreEvents(const char *types, const MYFLT *pFields,
+                  long numEvents, long numFields, long stride = 0)
+  {
+    if (numEvents <= 0 || numFields <= 0)
+      return 0;
+    if (stride == 0)
+      stride = numFields;
+    std::vector<long> order((size_t) numEvents);
+    for (long i = 0; i < numEvents; i++)
+      order[i] = i;
+    if (numFields > 1) {
+      ScoreEventStartTimeLess startTimeLess;
+      startTimeLess.pFields = pFields;
+      startTimeLess.stride = stride;
+      std::stable_sort(order.begin(), order.end(), startTimeLess);
+    }
+    csoundLockMutex(scoreEventsMutex);
+    double timeOffset = csoundGetScoreTime(csound);
+    int result = 0;
+    for (long i = 0; i < numEvents; i++) {
+      const MYFLT *row = pFields + order[i] * stride;
+      int eventResult = csoundScoreEventAbsolute(csound, types[order[i]],
+                                                 row, numFields, timeOffset);
+      if (result == 0)
+        result = eventResult;
+    }
+    csoundUnlockMutex(scoreEventsMutex);
+    return result;
+  }
+#endif
   // MIDI
   virtual void SetExternalMidiInOpenCallback(
       int (*func)(CSOUND *, void **, const char *))
@@ -837,6 +900,7 @@ public:
   Csound()
   {
     csound = csoundCreate((CSOUND*) 0);
+    scoreEventsMutex = csoundCreateMutex(0);
      #ifdef SWIGPYTHON
       pydata =(pycbdata *) new pycbdata;
       memset(pydata, 0, sizeof(pydata));
@@ -851,6 +915,7 @@ public:
   Csound(void *hostData)
   {
     csound = csoundCreate(hostData);
+    scoreEventsMutex = csoundCreateMutex(0);
     #ifdef SWIGPYTHON
     pydata =(pycbdata *) new pycbdata;
     ((pycbdata *)pydata)->mfunc = NULL;
@@ -864,6 +929,7 @@ public:
   virtual ~Csound()
   {
     csoundDestroy(csound);
+    csoundDestroyMutex(scoreEventsMutex);
     #ifdef SWIGPYTHON
     ((pycbdata *)pydata)->mfunc = NULL;
     delete (pycbdata *)pydata;
@@ -29,14 +29,24 @@
 #include <climits>
 #include <cmath>
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <eigen3/Eigen/Dense>
 #include "Event.hpp"
 #include <iostream>
 #include <iterator>
 #include <map>
+#include "MappedFile.hpp"
+#include <memory>
+#include <mutex>
+#include "PitchClassMask.hpp"
 #include "Score.hpp"
+#include "ScoreIndex.hpp"
 #include <set>
 #include <sstream>
+#include <stdint.h>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 %}
 %include "std_string.i"
@@ -47,14 +57,24 @@
 #include <climits>
 #include <cmath>
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <eigen3/Eigen/Dense>
 #include "Event.hpp"
 #include <iostream>
 #include <iterator>
 #include <map>
+#include "MappedFile.hpp"
+#include <memory>
+#include <mutex>
+#include "PitchClassMask.hpp"
 #include <Score.hpp>
+#include "ScoreIndex.hpp"
 #include <set>
 #include <sstream>
+#include <stdint.h>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #endif
 
@@ -272,21 +292,29 @@ inline SILENCE_PUBLIC double factorial(double n) {
     return result;
 }
 
-inline SILENCE_PUBLIC double EPSILON() {
-	static double epsilon = 1.0;
-	if (epsilon == 1.0) {
-		for (;;) {
-			epsilon = epsilon / 2.0;
-			double nextEpsilon = epsilon / 2.0;
-			double onePlusNextEpsilon = 1.0 + nextEpsilon;
-			if (onePlusNextEpsilon == 1.0) {
-				break;
-			}
+inline SILENCE_PUBLIC double computeEpsilon() {
+	double epsilon = 1.0;
+	for (;;) {
+		epsilon = epsilon / 2.0;
+		double nextEpsilon = epsilon / 2.0;
+		double onePlusNextEpsilon = 1.0 + nextEpsilon;
+		if (onePlusNextEpsilon == 1.0) {
+			break;
 		}
 	}
 	return epsilon;
 }
 
+/**
+ * Returns the machine epsilon. The value is computed once, by the
+ * initialization of a function-local static, which is thread-safe, so
+ * that chord space may be enumerated from several threads at once.
+ */
+inline SILENCE_PUBLIC double EPSILON() {
+	static const double epsilon = computeEpsilon();
+	return epsilon;
+}
+
 inline SILENCE_PUBLIC double &epsilonFactor() {
 	static double epsilonFactor = 100000.0;
 	return epsilonFactor;
@@ -902,10 +930,32 @@ public:
 	virtual Chord epcs() const {
 		Chord chord = *this;
 		for (size_t voice = 0; voice < voices(); voice++) {
-			chord.setPitch(voice, epc(getPitch(voice)));
+			double pitch = getPitch(voice);
+			if (isIntegralPitch(pitch)) {
+				chord.setPitch(voice, integralPitchClass(pitch));
+			} else {
+				chord.setPitch(voice, epc(pitch));
+			}
 		}
 		return chord;
 	}
+	/**
+	 * Computes the 12-bit mask of the chord's pitch-class set, as used by
+	 * PitchClassMasks; returns false, leaving mask unchanged, if any pitch
+	 * is not a whole number of semitones.
+	 */
+	virtual bool pitchClassMask(uint16_t &mask) const {
+		uint16_t result = 0;
+		for (size_t voice = 0; voice < voices(); voice++) {
+			double pitch = getPitch(voice);
+			if (!isIntegralPitch(pitch)) {
+				return false;
+			}
+			result |= uint16_t(1 << integralPitchClass(pitch));
+		}
+		mask = result;
+		return true;
+	}
 	/**
 	 * Returns whether the chord is within the fundamental domain of
 	 * transposition to 0.
@@ -1434,6 +1484,97 @@ inline SILENCE_PUBLIC bool operator >= (const Chord &a, const Chord &b) {
 	return (a > b);
 }
 
+/**
+ * An exact representation of the pitches of a Chord as fixed-point
+ * integers: each pitch is rounded to the nearest whole number of units,
+ * where resolution is the number of units per semitone (100, cents, by
+ * default; 1 / g for chords on the lattice of a ChordSpaceGroup).
+ * <p>
+ * Comparisons and hashing are exact, so QuantizedChords order std::set and
+ * std::map consistently and can key std::unordered_set and
+ * std::unordered_map, with QuantizedChord::Hash, without the epsilon
+ * comparisons of Chord. Chords whose pitches differ by less than half a
+ * unit have the same QuantizedChord; where that matters, confirm a match
+ * with Chord's operator ==. Only the pitches are represented, not the
+ * other rows of the Chord.
+ */
+class SILENCE_PUBLIC QuantizedChord {
+public:
+	struct Hash {
+		size_t operator()(const QuantizedChord &chord) const {
+			return chord.hash();
+		}
+	};
+	QuantizedChord() : resolution(100.0) {
+	}
+	explicit QuantizedChord(const Chord &chord, double resolution_ = 100.0) {
+		fromChord(chord, resolution_);
+	}
+	virtual ~QuantizedChord() {
+	}
+	virtual void fromChord(const Chord &chord, double resolution_ = 100.0) {
+		resolution = resolution_;
+		units.resize(chord.voices());
+		for (int voice = 0, n = chord.voices(); voice < n; ++voice) {
+			units[voice] = int32_t(std::floor(chord.getPitch(voice) * resolution + 0.5));
+		}
+	}
+	/**
+	 * Returns a Chord with the pitches of this; the other rows are the
+	 * defaults of a new Chord.
+	 */
+	virtual Chord toChord() const {
+		Chord chord;
+		chord.resize(voices());
+		for (int voice = 0, n = voices(); voice < n; ++voice) {
+			chord.setPitch(voice, getPitch(voice));
+		}
+		return chord;
+	}
+	int voices() const {
+		return int(units.size());
+	}
+	double getResolution() const {
+		return resolution;
+	}
+	int32_t getUnits(int voice) const {
+		return units[voice];
+	}
+	double getPitch(int voice) const {
+		return double(units[voice]) / resolution;
+	}
+	size_t hash() const {
+		uint64_t hash_ = 14695981039346656037ULL;
+		hash_ = (hash_ ^ std::hash<double>()(resolution)) * 1099511628211ULL;
+		for (size_t i = 0, n = units.size(); i < n; ++i) {
+			hash_ = (hash_ ^ uint64_t(uint32_t(units[i]))) * 1099511628211ULL;
+		}
+		return size_t(hash_);
+	}
+	bool operator == (const QuantizedChord &other) const {
+		return resolution == other.resolution && units == other.units;
+	}
+	bool operator != (const QuantizedChord &other) const {
+		return !(*this == other);
+	}
+	/**
+	 * Orders by voice as Chord's operator < does, with fewer voices first
+	 * when one chord is a prefix of the other, and by resolution last.
+	 */
+	bool operator < (const QuantizedChord &other) const {
+		if (units != other.units) {
+			return std::lexicographical_compare(units.begin(), units.end(), other.units.begin(), other.units.end());
+		}
+		return resolution < other.resolution;
+	}
+	virtual std::string toString() const {
+		return toChord().toString();
+	}
+protected:
+	double resolution;
+	std::vector<int32_t> units;
+};
+
 /**
  * Returns the Euclidean distance between chords a and b,
  * which must have the same number of voices.
@@ -1462,34 +1603,40 @@ inline SILENCE_PUBLIC Chord midpoint(const Chord &a, const Chord &b) {
 }
 
 
+inline SILENCE_PUBLIC std::map<std::string, double> createPitchClassesForNames() {
+	std::map<std::string, double> pitchClassesForNames_;
+	pitchClassesForNames_["Ab"] =   8.;
+	pitchClassesForNames_["A" ] =   9.;
+	pitchClassesForNames_["A#"] =  10.;
+	pitchClassesForNames_["Bb"] =  10.;
+	pitchClassesForNames_["B" ] =  11.;
+	pitchClassesForNames_["B#"] =   0.;
+	pitchClassesForNames_["Cb"] =  11.;
+	pitchClassesForNames_["C" ] =   0.;
+	pitchClassesForNames_["C#"] =   1.;
+	pitchClassesForNames_["Db"] =   1.;
+	pitchClassesForNames_["D" ] =   2.;
+	pitchClassesForNames_["D#"] =   3.;
+	pitchClassesForNames_["Eb"] =   3.;
+	pitchClassesForNames_["E" ] =   4.;
+	pitchClassesForNames_["E#"] =   5.;
+	pitchClassesForNames_["Fb"] =   4.;
+	pitchClassesForNames_["F" ] =   5.;
+	pitchClassesForNames_["F#"] =   6.;
+	pitchClassesForNames_["Gb"] =   6.;
+	pitchClassesForNames_["G" ] =   7.;
+	pitchClassesForNames_["G#"] =   8.;
+	return pitchClassesForNames_;
+}
+
+/**
+ * Returns the pitch classes for the names of pitch classes. The map is built
+ * once, on first use, by the thread-safe initialization of a function-local
+ * static, and is never changed.
+ */
 inline SILENCE_PUBLIC const std::map<std::string, double> &pitchClassesForNames() {
-	static bool pitchClassesForNamesInitialized = false;
-	static std::map<std::string, double> pitchClassesForNames_;
-	if (!pitchClassesForNamesInitialized) {
-		pitchClassesForNamesInitialized = true;
-		pitchClassesForNames_["Ab"] =   8.;
-		pitchClassesForNames_["A" ] =   9.;
-		pitchClassesForNames_["A#"] =  10.;
-		pitchClassesForNames_["Bb"] =  10.;
-		pitchClassesForNames_["B" ] =  11.;
-		pitchClassesForNames_["B#"] =   0.;
-		pitchClassesForNames_["Cb"] =  11.;
-		pitchClassesForNames_["C" ] =   0.;
-		pitchClassesForNames_["C#"] =   1.;
-		pitchClassesForNames_["Db"] =   1.;
-		pitchClassesForNames_["D" ] =   2.;
-		pitchClassesForNames_["D#"] =   3.;
-		pitchClassesForNames_["Eb"] =   3.;
-		pitchClassesForNames_["E" ] =   4.;
-		pitchClassesForNames_["E#"] =   5.;
-		pitchClassesForNames_["Fb"] =   4.;
-		pitchClassesForNames_["F" ] =   5.;
-		pitchClassesForNames_["F#"] =   6.;
-		pitchClassesForNames_["Gb"] =   6.;
-		pitchClassesForNames_["G" ] =   7.;
-		pitchClassesForNames_["G#"] =   8.;
-	}
-	return const_cast<std::map<std::string, double> &>(pitchClassesForNames_);
+	static const std::map<std::string, double> pitchClassesForNames_ = createPitchClassesForNames();
+	return pitchClassesForNames_;
 }
 
 inline SILENCE_PUBLIC double pitchClassForName(std::string name) {
@@ -1502,16 +1649,6 @@ inline SILENCE_PUBLIC double pitchClassForName(std::string name) {
 	}
 }
 
-inline SILENCE_PUBLIC std::map<Chord, std::string> &namesForChords() {
-	static std::map<Chord, std::string> namesForChords_;
-	return namesForChords_;
-}
-
-inline SILENCE_PUBLIC std::map<std::string, Chord> &chordsForNames() {
-	static std::map<std::string, Chord> chordsForNames_;
-	return chordsForNames_;
-}
-
 inline SILENCE_PUBLIC std::vector<std::string> split(std::string string_) {
 	std::vector<std::string> tokens;
 	std::istringstream iss(string_);
@@ -1521,37 +1658,71 @@ inline SILENCE_PUBLIC std::vector<std::string> split(std::string string_) {
 	return tokens;
 }
 
-inline void fill(std::string rootName, double rootPitch, std::string typeName, std::string typePitches, bool debug = false) {
-	Chord chord;
-	std::string chordName = rootName + typeName;
-	std::vector<std::string> splitPitches = split(typePitches);
-	if (debug) {
-		csound::print("chordName: %s = rootName: %s  rootPitch: %f  typeName: %s  typePitches: %s\n", chordName.c_str(), rootName.c_str(), rootPitch, typeName.c_str(), typePitches.c_str());
-	}
-	chord.resize(splitPitches.size());
-	for (int voice = 0, voiceN = splitPitches.size(); voice < voiceN; ++voice) {
-		double pitch = pitchClassForName(splitPitches[voice]);
-		if (debug) {
-			csound::print("voice: %3d  pc: %-4s  pitch: %9.4f\n", voice, splitPitches[voice].c_str(), pitch);
-		}
-		chord.setPitch(voice, pitch);
+/**
+ * The dictionary of chord and scale names: every chord type below, on every
+ * root in pitchClassesForNames(), in OP. The dictionary is built once, by
+ * instance(), and is immutable thereafter, so any number of threads may look
+ * up names and chords in it at the same time without locking.
+ * <p>
+ * Because the chords in the dictionary have integral pitches, nameForChord
+ * first looks up the rounded pitches of the chord in a hash table, and
+ * falls back to the O(log n) epsilon comparisons of namesForChords only for
+ * chords that are not equal to their rounded pitches.
+ */
+class SILENCE_PUBLIC ChordNames {
+public:
+	/**
+	 * Returns the one dictionary, building it on first use. C++11 guarantees
+	 * that concurrent first calls build it only once, and that all of them
+	 * wait for it to be built.
+	 */
+	static const ChordNames &instance() {
+		static const ChordNames chordNames;
+		return chordNames;
 	}
-	if (debug) {
-		print("chord type: %s\n", chord.toString().c_str());
+	static QuantizedChord key(const Chord &chord) {
+		return QuantizedChord(chord, 1.0);
 	}
-	chord = chord.T(rootPitch);
-	Chord eOP_ = chord.eOP();
-	if (debug) {
-		print("eOP_:   %s  chordName: %s\n", eOP_.toString().c_str(), chordName.c_str());
+	/**
+	 * Returns the name of the chord, which must be in OP, or an empty
+	 * string if it has no name.
+	 */
+	std::string nameForChord(const Chord &chord) const {
+		std::unordered_map<QuantizedChord, std::map<Chord, std::string>::const_iterator, QuantizedChord::Hash>::const_iterator hashed = hashedNamesForChords.find(key(chord));
+		if (hashed != hashedNamesForChords.end() && hashed->second->first == chord) {
+			return hashed->second->second;
+		}
+		std::map<Chord, std::string>::const_iterator it = namesForChords.find(chord);
+		if (it == namesForChords.end()) {
+			return "";
+		}
+		return it->second;
 	}
-	chordsForNames()[chordName] = eOP_;
-	namesForChords()[eOP_] = chordName;
-}
-
-inline void initializeNames() {
-	static bool initializeNamesInitialized = false;
-	if (!initializeNamesInitialized) {
-		initializeNamesInitialized = true;
+	/**
+	 * Returns the chord, in OP, for the name, or an empty chord if there is
+	 * no chord by that name.
+	 */
+	const Chord &chordForName(const std::string &name) const {
+		std::unordered_map<std::string, const Chord *>::const_iterator it = hashedChordsForNames.find(name);
+		if (it == hashedChordsForNames.end()) {
+			return emptyChord;
+		}
+		return *it->second;
+	}
+	const std::map<Chord, std::string> &getNamesForChords() const {
+		return namesForChords;
+	}
+	const std::map<std::string, Chord> &getChordsForNames() const {
+		return chordsForNames;
+	}
+protected:
+	std::map<Chord, std::string> namesForChords;
+	std::map<std::string, Chord> chordsForNames;
+	std::unordered_map<QuantizedChord, std::map<Chord, std::string>::const_iterator, QuantizedChord::Hash> hashedNamesForChords;
+	std::unordered_map<std::string, const Chord *> hashedChordsForNames;
+	Chord emptyChord;
+	ChordNames() {
+		emptyChord.resize(0);
 		csound::print("Initializing chord names...\n");
 		const std::map<std::string, double> &pitchClassesForNames_ = pitchClassesForNames();
 		for (std::map<std::string, double>::const_iterator it = pitchClassesForNames_.begin();
@@ -1635,38 +1806,66 @@ inline void initializeNames() {
 			fill(rootName, rootPitch, "13",                "C     D      E F     G     A  Bb  ");
 			fill(rootName, rootPitch, "13#11",             "C     D      E F#    G     A  Bb  ");
 		}
+		for (std::map<Chord, std::string>::const_iterator it = namesForChords.begin(); it != namesForChords.end(); ++it) {
+			hashedNamesForChords[key(it->first)] = it;
+		}
+		for (std::map<std::string, Chord>::const_iterator it = chordsForNames.begin(); it != chordsForNames.end(); ++it) {
+			hashedChordsForNames[it->first] = &it->second;
+		}
+	}
+	ChordNames(const ChordNames &) = delete;
+	ChordNames &operator = (const ChordNames &) = delete;
+	void fill(std::string rootName, double rootPitch, std::string typeName, std::string typePitches, bool debug = false) {
+		Chord chord;
+		std::string chordName = rootName + typeName;
+		std::vector<std::string> splitPitches = split(typePitches);
+		if (debug) {
+			csound::print("chordName: %s = rootName: %s  rootPitch: %f  typeName: %s  typePitches: %s\n", chordName.c_str(), rootName.c_str(), rootPitch, typeName.c_str(), typePitches.c_str());
+		}
+		chord.resize(splitPitches.size());
+		for (int voice = 0, voiceN = splitPitches.size(); voice < voiceN; ++voice) {
+			double pitch = pitchClassForName(splitPitches[voice]);
+			if (debug) {
+				csound::print("voice: %3d  pc: %-4s  pitch: %9.4f\n", voice, splitPitches[voice].c_str(), pitch);
+			}
+			chord.setPitch(voice, pitch);
+		}
+		if (debug) {
+			print("chord type: %s\n", chord.toString().c_str());
+		}
+		chord = chord.T(rootPitch);
+		Chord eOP_ = chord.eOP();
+		if (debug) {
+			print("eOP_:   %s  chordName: %s\n", eOP_.toString().c_str(), chordName.c_str());
+		}
+		chordsForNames[chordName] = eOP_;
+		namesForChords[eOP_] = chordName;
 	}
+};
+
+inline SILENCE_PUBLIC const std::map<Chord, std::string> &namesForChords() {
+	return ChordNames::instance().getNamesForChords();
+}
+
+inline SILENCE_PUBLIC const std::map<std::string, Chord> &chordsForNames() {
+	return ChordNames::instance().getChordsForNames();
+}
+
+/**
+ * Builds the dictionary of chord names, if it has not already been built.
+ * Call this before starting threads that use chord names, to keep its cost
+ * out of them; it is not otherwise necessary.
+ */
+inline void initializeNames() {
+	ChordNames::instance();
 }
 
 inline SILENCE_PUBLIC std::string nameForChord(const Chord &chord) {
-	static bool nameForChordInitialized = false;
-	if (!nameForChordInitialized) {
-		nameForChordInitialized = true;
-		initializeNames();
-	}
-	std::map<Chord, std::string> &namesForChords_ = namesForChords();
-	if (namesForChords_.find(chord) == namesForChords_.end()) {
-		return "";
-	} else {
-		return namesForChords_[chord];
-	}
+	return ChordNames::instance().nameForChord(chord);
 }
 
 inline SILENCE_PUBLIC const Chord &chordForName(std::string name) {
-	static bool chordForNameInitialized = false;
-	if (!chordForNameInitialized) {
-		chordForNameInitialized = true;
-		initializeNames();
-	}
-	const std::map<std::string, Chord> chordsForNames_ = chordsForNames();
-	std::map<std::string, Chord>::const_iterator it = chordsForNames_.find(name);
-	if (it == chordsForNames_.end()) {
-		static Chord chord;
-		chord.resize(0);
-		return chord;
-	} else {
-		return it->second;
-	}
+	return ChordNames::instance().chordForName(name);
 }
 
 inline SILENCE_PUBLIC bool next(Chord &iterator_, const Chord &origin, double range, double g) {
@@ -1883,21 +2082,136 @@ inline SILENCE_PUBLIC Chord voiceleadingCloser(const Chord &source, const Chord
 	return voiceleadingSimpler(source, d1, d2, avoidParallels);
 }
 
+/**
+ * Scores of the voice-leadings from one source chord to each of a packed
+ * array of candidate chords, as computed by scoreVoiceleadings. Element i
+ * is for candidate i; the values are identical to those of
+ * voiceleadingSmoothness, euclidean, voiceleading(...).count(0.0), and
+ * voiceleading(...).count(7) for that candidate.
+ */
+struct SILENCE_PUBLIC VoiceleadingScores {
+	Eigen::VectorXd smoothness;
+	Eigen::VectorXd euclidean;
+	Eigen::VectorXi commonTones;
+	Eigen::VectorXi fifths;
+	/**
+	 * Same as parallelFifth(source, candidate).
+	 */
+	bool parallelFifth(int candidate) const {
+		return fifths(candidate) > 1;
+	}
+};
+
+/**
+ * Packs chords into a matrix with one row per chord and one column per
+ * voice. Eigen stores the matrix by columns, so each voice of all the
+ * chords is contiguous, which is the layout scoreVoiceleadings vectorizes.
+ */
+inline SILENCE_PUBLIC Eigen::MatrixXd packChords(const std::vector<Chord> &chords) {
+	Eigen::MatrixXd packed(chords.size(), chords.empty() ? 0 : chords.front().voices());
+	for (int i = 0, n = packed.rows(); i < n; ++i) {
+		for (int voice = 0, voices = packed.cols(); voice < voices; ++voice) {
+			packed(i, voice) = chords[i].getPitch(voice);
+		}
+	}
+	return packed;
+}
+
+/**
+ * Scores the voice-leadings from the source to every candidate (one row
+ * of candidates per chord, as produced by packChords) in one pass, one
+ * voice at a time across all candidates, so that Eigen vectorizes each
+ * step. Sums are accumulated in voice order, as in the single chord
+ * functions, so the results are identical to theirs.
+ */
+inline SILENCE_PUBLIC void scoreVoiceleadings(const Chord &source, const Eigen::Ref<const Eigen::MatrixXd> &candidates, VoiceleadingScores &scores) {
+	int n = candidates.rows();
+	double tolerance = EPSILON() * epsilonFactor();
+	scores.smoothness.setZero(n);
+	scores.commonTones.setZero(n);
+	scores.fifths.setZero(n);
+	Eigen::ArrayXd sumOfSquaredDifferences = Eigen::ArrayXd::Zero(n);
+	Eigen::ArrayXd interval(n);
+	for (int voice = 0, voices = candidates.cols(); voice < voices; ++voice) {
+		interval = candidates.col(voice).array() - source.getPitch(voice);
+		scores.smoothness.array() += interval.abs();
+		sumOfSquaredDifferences += interval.square();
+		scores.commonTones.array() += (interval.abs() < tolerance).cast<int>();
+		scores.fifths.array() += ((interval - 7.0).abs() < tolerance).cast<int>();
+	}
+	scores.euclidean = sumOfSquaredDifferences.sqrt().matrix();
+}
+
+/**
+ * Returns which of candidates c1 and c2 in the scores voiceleadingCloser
+ * would return for them, without recomputing anything.
+ */
+inline SILENCE_PUBLIC int voiceleadingCloserIndex(const VoiceleadingScores &scores, int c1, int c2, bool avoidParallels = false) {
+	if (avoidParallels) {
+		if (scores.parallelFifth(c1)) {
+			return c2;
+		}
+		if (scores.parallelFifth(c2)) {
+			return c1;
+		}
+	}
+	if (scores.smoothness(c1) < scores.smoothness(c2)) {
+		return c1;
+	}
+	// As in voiceleadingSimpler.
+	if (scores.commonTones(c1) > scores.commonTones(c2)) {
+		return c1;
+	}
+	if (scores.commonTones(c2) > scores.commonTones(c1)) {
+		return c2;
+	}
+	return c1;
+}
+
 /**
  * Returns the voicing of the destination which has the closest voice-leading
  * from the source within the range, optionally avoiding parallel fifths.
+ * The revoicings are scored in batches by scoreVoiceleadings, with the
+ * current choice as the first candidate of each batch, and chosen among
+ * in the same order as by folding voiceleadingCloser over them.
  */
 inline SILENCE_PUBLIC Chord voiceleadingClosestRange(const Chord &source, const Chord &destination, double range, bool avoidParallels = false) {
 	Chord destinationOP = destination.eOP();
 	Chord d = destinationOP;
     Chord origin = source.eOP();
 	Chord odometer = origin;
-	while (next(odometer, origin, range, OCTAVE())) {
-		Chord revoicing = odometer;
-		for (int voice = 0; voice < revoicing.voices(); ++voice) {
-			revoicing.setPitch(voice, revoicing.getPitch(voice) + destinationOP.getPitch(voice));
+	const int batchN = 1024;
+	int voices = destinationOP.voices();
+	Eigen::MatrixXd candidates(batchN, voices);
+	VoiceleadingScores scores;
+	bool more = true;
+	while (more) {
+		for (int voice = 0; voice < voices; ++voice) {
+			candidates(0, voice) = d.getPitch(voice);
+		}
+		int n = 1;
+		while (n < batchN && (more = next(odometer, origin, range, OCTAVE()))) {
+			for (int voice = 0; voice < voices; ++voice) {
+				candidates(n, voice) = odometer.getPitch(voice) + destinationOP.getPitch(voice);
+			}
+			n++;
+		}
+		if (n == 1) {
+			break;
+		}
+		scoreVoiceleadings(source, candidates.topRows(n), scores);
+		int closest = 0;
+		for (int i = 1; i < n; ++i) {
+			closest = voiceleadingCloserIndex(scores, closest, i, avoidParallels);
+		}
+		if (closest != 0) {
+			// A revoicing is the odometer, whose other columns are those of
+			// origin, with the destination's pitches added.
+			d = origin;
+			for (int voice = 0; voice < voices; ++voice) {
+				d.setPitch(voice, candidates(closest, voice));
+			}
 		}
-		d = voiceleadingCloser(source, d, revoicing, avoidParallels);
 	}
 	return d;
 }
@@ -1977,6 +2291,34 @@ inline SILENCE_PUBLIC std::vector<Event *> slice(Score &score, double startTime,
 	return result;
 }
 
+/**
+ * Returns the same slice as slice(score, startTime, endTime), using a time
+ * index of the score to find the events in O(log n) rather than scanning
+ * the whole score; the index is rebuilt if the score has changed.
+ */
+inline SILENCE_PUBLIC std::vector<Event *> slice(Score &score, ScoreTimeIndex &index, double startTime, double endTime) {
+	std::vector<size_t> indexes = index.starting(score, startTime, endTime);
+	std::vector<Event *> result;
+	for (int i = 0, n = indexes.size(); i < n; ++i) {
+		Event *event = &score[indexes[i]];
+		if (event->isNoteOn()) {
+			result.push_back(event);
+		}
+	}
+	return result;
+}
+
+/**
+ * Moves the pitch of each note in the slice to belong to the chord, using
+ * the conformToChord function.
+ */
+inline SILENCE_PUBLIC void apply(const std::vector<Event *> &slice_, const Chord &chord, bool octaveEquivalence = true) {
+	for (size_t i = 0; i < slice_.size(); ++i) {
+		Event &event = *slice_[i];
+		conformToChord(event, chord, octaveEquivalence);
+	}
+}
+
 /**
  * For all the notes in the Score
  * beginning at or later than the start time,
@@ -1985,11 +2327,35 @@ inline SILENCE_PUBLIC std::vector<Event *> slice(Score &score, double startTime,
  * conformToChord function.
  */
 inline SILENCE_PUBLIC void apply(Score &score, const Chord &chord, double startTime, double endTime, bool octaveEquivalence = true) {
-	std::vector<Event *> slice_ = slice(score, startTime, endTime);
-	for (int i = 0; i < slice_.size(); ++i) {
-		Event &event = *slice_[i];
-		conformToChord(event, chord, octaveEquivalence);
+	apply(slice(score, startTime, endTime), chord, octaveEquivalence);
+}
+
+/**
+ * As apply(score, chord, startTime, endTime, octaveEquivalence), but using
+ * a time index of the score; when applying chords to many segments of the
+ * same score, this avoids scanning the whole score for each segment.
+ * Only pitches are changed, so the index remains valid.
+ */
+inline SILENCE_PUBLIC void apply(Score &score, ScoreTimeIndex &index, const Chord &chord, double startTime, double endTime, bool octaveEquivalence = true) {
+	apply(slice(score, index, startTime, endTime), chord, octaveEquivalence);
+}
+
+/**
+ * Returns a chord containing all the pitches of the notes in the slice.
+ */
+inline SILENCE_PUBLIC Chord gather(const std::vector<Event *> &slice_) {
+	std::set<double> pitches;
+	for (size_t i = 0; i < slice_.size(); ++i) {
+		pitches.insert(slice_[i]->getKey());
+	}
+	Chord chord;
+	chord.resize(pitches.size());
+	int voice = 0;
+	for (std::set<double>::iterator it = pitches.begin(); it != pitches.end(); ++it) {
+		chord.setPitch(voice, *it);
+		voice++;
 	}
+	return chord;
 }
 
 /**
@@ -1998,10 +2364,30 @@ inline SILENCE_PUBLIC void apply(Score &score, const Chord &chord, double startT
  * and up to but not including the end time.
  */
 inline SILENCE_PUBLIC Chord gather(Score &score, double startTime, double endTime) {
-	std::vector<Event *> slice_ = slice(score, startTime, endTime);
+	return gather(slice(score, startTime, endTime));
+}
+
+/**
+ * As gather(score, startTime, endTime), but using a time index of the score.
+ */
+inline SILENCE_PUBLIC Chord gather(Score &score, ScoreTimeIndex &index, double startTime, double endTime) {
+	return gather(slice(score, index, startTime, endTime));
+}
+
+/**
+ * Returns a chord containing all the pitches of the notes in the score that
+ * sound at some time from the start time up to but not including the end
+ * time, including notes that began earlier and are still held, found with
+ * an interval tree of the score.
+ */
+inline SILENCE_PUBLIC Chord gather(Score &score, ScoreIntervalTree &tree, double startTime, double endTime) {
+	std::vector<size_t> indexes = tree.overlapping(score, startTime, endTime);
 	std::set<double> pitches;
-	for (int i = 0; i < slice_.size(); ++i) {
-		pitches.insert(slice_[i]->getKey());
+	for (size_t i = 0; i < indexes.size(); ++i) {
+		const Event &event = score[indexes[i]];
+		if (event.isNoteOn()) {
+			pitches.insert(event.getKey());
+		}
 	}
 	Chord chord;
 	chord.resize(pitches.size());
@@ -2010,26 +2396,14 @@ inline SILENCE_PUBLIC Chord gather(Score &score, double startTime, double endTim
 		chord.setPitch(voice, *it);
 		voice++;
 	}
-        return chord;
+	return chord;
 }
 
-inline SILENCE_PUBLIC int octavewiseRevoicings(const Chord &chord,
-                                               double range = OCTAVE()) {
-    Chord origin = chord.eOP();
-    Chord odometer = origin;
-    // Enumerate the permutations.
-    int voicings = 0;
-    while (next(odometer, origin, range, OCTAVE())) {
-      voicings = voicings + 1;
-    }
-    if (debug) {
-      print("octavewiseRevoicings: chord:    %s\n", chord.toString().c_str());
-      print("octavewiseRevoicings: eop:      %s\n", chord.eOP().toString().c_str());
-      print("octavewiseRevoicings: odometer: %s\n", odometer.toString().c_str());
-      print("octavewiseRevoicings: voicings: %5d\n", voicings);
-    }
-    return voicings;
-}
+/**
+ * Returns the number of octavewise revoicings of the chord within the
+ * range, not counting its OP form.
+ */
+SILENCE_PUBLIC int octavewiseRevoicings(const Chord &chord, double range = OCTAVE());
 
 SILENCE_PUBLIC Chord octavewiseRevoicing(const Chord &chord, int revoicingNumber_, double range, bool debug=false);
 /**
@@ -2060,7 +2434,7 @@ template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC bool isNormal(const Cho
     return result;
 }
 
-template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC bool isEquivalent(const Chord &a, const Chord &b, double range, double g) {
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC bool isEquivalentByNormalize(const Chord &a, const Chord &b, double range, double g) {
 	if (isNormal<EQUIVALENCE_RELATION>(a, range, g) == false) {
 		return false;
 	}
@@ -2076,6 +2450,98 @@ template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC bool isEquivalent(const
     }
 }
 
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC bool isEquivalent(const Chord &a, const Chord &b, double range, double g) {
+    return isEquivalentByNormalize<EQUIVALENCE_RELATION>(a, b, range, g);
+}
+
+/**
+ * Returns whether every pitch of the chord is exactly a whole number of
+ * semitones. For such chords, epsilon comparisons are exact comparisons,
+ * and the P, T, and I relations can be decided without normalizing.
+ */
+inline SILENCE_PUBLIC bool hasIntegralPitches(const Chord &chord) {
+    for (size_t voice = 0; voice < chord.voices(); ++voice) {
+        if (!isIntegralPitch(chord.getPitch(voice))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns whether two chords with integral pitches have the same pitches
+ * in the same order.
+ */
+inline SILENCE_PUBLIC bool integralPitchesEqual(const Chord &a, const Chord &b) {
+    if (a.voices() != b.voices()) {
+        return false;
+    }
+    for (size_t voice = 0; voice < a.voices(); ++voice) {
+        if (a.getPitch(voice) != b.getPitch(voice)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the prime form of the chord's pitch-class set under transposition
+ * (if inversion is false) or under transposition and inversion, as a sorted
+ * pitch-class set. For chords whose pitches are whole numbers of semitones,
+ * the prime is looked up in PitchClassMasks; otherwise it is the least
+ * rotation, by operator <, of the sorted, duplicate-free pitch-class set
+ * transposed to begin at 0 (and of its inversion), computed with the
+ * epsilon comparisons. The prime form of a chord with no voices has no
+ * voices.
+ */
+inline SILENCE_PUBLIC Chord pitchClassSetPrimeForm(const Chord &chord, bool inversion = false) {
+    if (chord.voices() == 0) {
+        Chord empty;
+        empty.resize(0);
+        return empty;
+    }
+    uint16_t mask;
+    if (chord.pitchClassMask(mask)) {
+        const PitchClassMasks &masks = PitchClassMasks::instance();
+        std::vector<double> pcs = maskToPitchClasses(inversion ? masks.primeTI(mask) : masks.primeT(mask));
+        Chord prime;
+        prime.resize(pcs.size());
+        prime.setZero();
+        for (size_t voice = 0; voice < pcs.size(); ++voice) {
+            prime.setPitch(voice, pcs[voice]);
+        }
+        return prime;
+    }
+    std::vector<Chord> candidates;
+    for (int inverted = 0; inverted < (inversion ? 2 : 1); ++inverted) {
+        Chord source = inverted ? chord.I() : chord;
+        std::vector<double> pcs;
+        for (size_t voice = 0; voice < source.voices(); ++voice) {
+            double pc = epc(source.getPitch(voice));
+            bool found = false;
+            for (size_t i = 0; i < pcs.size(); ++i) {
+                if (eq_epsilon(pcs[i], pc)) {
+                    found = true;
+                }
+            }
+            if (!found) {
+                pcs.push_back(pc);
+            }
+        }
+        std::sort(pcs.begin(), pcs.end());
+        for (size_t rotation = 0; rotation < pcs.size(); ++rotation) {
+            Chord candidate;
+            candidate.resize(pcs.size());
+            candidate.setZero();
+            for (size_t voice = 0; voice < pcs.size(); ++voice) {
+                candidate.setPitch(voice, epc(pcs[(rotation + voice) % pcs.size()] - pcs[rotation]));
+            }
+            candidates.push_back(candidate);
+        }
+    }
+    return *std::min_element(candidates.begin(), candidates.end());
+}
+
 template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC bool isEquivalent(const Chord &a, const Chord &b, double range) {
     return isEquivalent<EQUIVALENCE_RELATION>(a, b, range, 1.0);
 }
@@ -2092,28 +2558,540 @@ template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC Chord normalize(const C
     return normalize<EQUIVALENCE_RELATION>(chord, OCTAVE());
 }
 
-//	EQUIVALENCE_RELATION_r
-
-template<> inline SILENCE_PUBLIC bool isNormal<EQUIVALENCE_RELATION_r>(const Chord &chord, double range, double g) {
-    for (int voice = 0; voice < chord.voices(); ++voice) {
-        double pitch = chord.getPitch(voice);
-        if (le_epsilon(0.0, pitch) == false) {
-            return false;
+/**
+ * A bounded, thread-safe memo of normalize<> results, for searches that
+ * normalize the same few chords many times. Entries are keyed by the
+ * equivalence relation, range, g, and every element of the chord
+ * quantized to a step smaller than the tolerance of eq_epsilon, so that
+ * chords sharing a key are equal within that tolerance. When the cache
+ * holds the maximum number of entries it is cleared.
+ * <p>
+ * The cache is used only by normalizeCached<>, which callers opt into for
+ * searches that are known to revisit chords; the Chord members such as
+ * eOP() always normalize directly, because for chords that are not
+ * revisited, building the key, hashing it, locking, and copying cost
+ * several times as much as the normalization itself, and the shared lock
+ * serializes threads. A hit returns the result stored for an earlier
+ * chord with the same key, which may differ from the given chord in its
+ * last bits, so a cached result is equal to the direct result of
+ * normalize<> within the tolerance of eq_epsilon, but is not necessarily
+ * bit-identical to it.
+ */
+class SILENCE_PUBLIC NormalizationCache {
+protected:
+    struct Key {
+        int relation;
+        double range;
+        double g;
+        int rows;
+        int columns;
+        std::vector<int64_t> elements;
+        bool operator == (const Key &other) const {
+            return relation == other.relation && range == other.range && g == other.g &&
+                rows == other.rows && columns == other.columns && elements == other.elements;
         }
-        if (lt_epsilon(pitch, range) == false) {
-            return false;
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            uint64_t hash = 1469598103934665603ULL;
+            hash = (hash ^ uint64_t(key.relation)) * 1099511628211ULL;
+            hash = (hash ^ uint64_t(key.rows)) * 1099511628211ULL;
+            hash = (hash ^ std::hash<double>()(key.range)) * 1099511628211ULL;
+            hash = (hash ^ std::hash<double>()(key.g)) * 1099511628211ULL;
+            for (size_t i = 0; i < key.elements.size(); ++i) {
+                hash = (hash ^ uint64_t(key.elements[i])) * 1099511628211ULL;
+            }
+            return size_t(hash);
+        }
+    };
+    std::mutex mutex;
+    std::unordered_map<Key, Chord, KeyHash> entries;
+    size_t capacity;
+    bool enabled;
+    uint64_t hits;
+    uint64_t misses;
+    static Key key(int relation, const Chord &chord, double range, double g) {
+        Key key_;
+        key_.relation = relation;
+        key_.range = range;
+        key_.g = g;
+        key_.rows = int(chord.rows());
+        key_.columns = int(chord.cols());
+        key_.elements.resize(chord.size());
+        double step = EPSILON() * epsilonFactor();
+        for (Eigen::Index i = 0; i < chord.size(); ++i) {
+            key_.elements[i] = int64_t(std::floor(chord.data()[i] / step));
         }
+        return key_;
     }
-    return true;
-}
-
-template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_r>(const Chord &chord, double range, double g) {
-	Chord normal = chord;
-	for (int voice = 0; voice < chord.voices(); ++voice) {
-		double pitch = chord.getPitch(voice);
-		pitch = modulo(pitch, range);
-		normal.setPitch(voice, pitch);
-	}
+public:
+    NormalizationCache() : capacity(100000), enabled(true), hits(0), misses(0) {
+    }
+    static NormalizationCache &instance() {
+        static NormalizationCache cache;
+        return cache;
+    }
+    bool isEnabled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return enabled;
+    }
+    /**
+     * Enables or disables the cache; disabling it also clears it.
+     */
+    void setEnabled(bool enabled_) {
+        std::lock_guard<std::mutex> lock(mutex);
+        enabled = enabled_;
+        if (!enabled) {
+            entries.clear();
+        }
+    }
+    size_t getCapacity() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return capacity;
+    }
+    void setCapacity(size_t capacity_) {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = capacity_;
+        if (entries.size() > capacity) {
+            entries.clear();
+        }
+    }
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+    uint64_t getHits() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hits;
+    }
+    uint64_t getMisses() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return misses;
+    }
+    /**
+     * Returns hits / (hits + misses), or 0 before any lookup.
+     */
+    double getHitRate() {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : double(hits) / double(lookups);
+    }
+    void resetCounters() {
+        std::lock_guard<std::mutex> lock(mutex);
+        hits = 0;
+        misses = 0;
+    }
+    /**
+     * Returns normalize<EQUIVALENCE_RELATION>(chord, range, g), from the
+     * cache if possible.
+     */
+    template<int EQUIVALENCE_RELATION> Chord normalize(const Chord &chord, double range, double g) {
+        if (!isEnabled()) {
+            return csound::normalize<EQUIVALENCE_RELATION>(chord, range, g);
+        }
+        Key key_ = key(EQUIVALENCE_RELATION, chord, range, g);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            typename std::unordered_map<Key, Chord, KeyHash>::const_iterator it = entries.find(key_);
+            if (it != entries.end()) {
+                hits++;
+                return it->second;
+            }
+            misses++;
+        }
+        // Normalize outside the lock, so that other threads are not blocked.
+        Chord normal = csound::normalize<EQUIVALENCE_RELATION>(chord, range, g);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (enabled && capacity > 0) {
+                if (entries.size() >= capacity) {
+                    entries.clear();
+                }
+                entries.insert(std::make_pair(key_, normal));
+            }
+        }
+        return normal;
+    }
+};
+
+/**
+ * Returns normalize<EQUIVALENCE_RELATION>(chord, range, g) through the
+ * shared NormalizationCache; the result is equal to that of normalize<>
+ * within the tolerance of eq_epsilon, but may not be bit-identical.
+ */
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC Chord normalizeCached(const Chord &chord, double range, double g = 1.0) {
+    return NormalizationCache::instance().normalize<EQUIVALENCE_RELATION>(chord, range, g);
+}
+
+/**
+ * A chord with a fixed number of voices, N, whose pitches are held in an
+ * array on the stack rather than in the heap allocated matrix of Chord. It
+ * implements the composite normalizations (RP, RPT, RPTg, RPI, RPTI, and
+ * RPTgI) with exactly the same arithmetic, comparisons, and order of
+ * operations as the Chord versions, so that the results are identical, but
+ * without allocating a temporary Chord for each step. It records, for each
+ * voice, the row of the source Chord it came from, so that durations,
+ * loudnesses, and the other columns follow their pitches when the result
+ * is converted back to a Chord.
+ */
+template<int N> class SILENCE_PUBLIC ChordN {
+public:
+    double pitches[N];
+    int sourceRows[N];
+    ChordN() {
+    }
+    explicit ChordN(const Chord &chord) {
+        fromChord(chord);
+    }
+    void fromChord(const Chord &chord) {
+        for (int voice = 0; voice < N; ++voice) {
+            pitches[voice] = chord.getPitch(voice);
+            sourceRows[voice] = voice;
+        }
+    }
+    /**
+     * Returns a copy of source, which must be the chord this was created
+     * from, with its rows permuted as the voices of this have been, and
+     * with the pitches of this.
+     */
+    Chord toChord(const Chord &source) const {
+        Chord chord = source;
+        for (int voice = 0; voice < N; ++voice) {
+            chord.row(voice) = source.row(sourceRows[voice]);
+            chord.setPitch(voice, pitches[voice]);
+        }
+        return chord;
+    }
+    double layer() const {
+        double sum = 0.0;
+        for (int voice = 0; voice < N; ++voice) {
+            sum += pitches[voice];
+        }
+        return sum;
+    }
+    int maxVoice() const {
+        int result = 0;
+        for (int voice = 1; voice < N; ++voice) {
+            if (gt_epsilon(pitches[voice], pitches[result])) {
+                result = voice;
+            }
+        }
+        return result;
+    }
+    int minVoice() const {
+        int result = 0;
+        for (int voice = 1; voice < N; ++voice) {
+            if (lt_epsilon(pitches[voice], pitches[result])) {
+                result = voice;
+            }
+        }
+        return result;
+    }
+    void swap(int a, int b) {
+        std::swap(pitches[a], pitches[b]);
+        std::swap(sourceRows[a], sourceRows[b]);
+    }
+    void T(double interval) {
+        for (int voice = 0; voice < N; ++voice) {
+            pitches[voice] = csound::T(pitches[voice], interval);
+        }
+    }
+    void I(double center = 0.0) {
+        for (int voice = 0; voice < N; ++voice) {
+            pitches[voice] = csound::I(pitches[voice], center);
+        }
+    }
+    /**
+     * Same as Chord::v(1): cycles the voices down by one and adds an
+     * octave to the new highest voice.
+     */
+    void v() {
+        double pitch = pitches[0];
+        int row = sourceRows[0];
+        for (int voice = 1; voice < N; ++voice) {
+            pitches[voice - 1] = pitches[voice];
+            sourceRows[voice - 1] = sourceRows[voice];
+        }
+        pitches[N - 1] = pitch + OCTAVE();
+        sourceRows[N - 1] = row;
+    }
+    bool isNormalR(double range) const {
+        if (le_epsilon(pitches[maxVoice()], (pitches[minVoice()] + range)) == false) {
+            return false;
+        }
+        double layer_ = layer();
+        if (le_epsilon(0.0, layer_) == false) {
+            return false;
+        }
+        if (lt_epsilon(layer_, range) == false) {
+            return false;
+        }
+        return true;
+    }
+    bool isNormalP() const {
+        for (int voice = 1; voice < N; voice++) {
+            if (gt_epsilon(pitches[voice - 1], pitches[voice])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool isNormalV(double range) const {
+        double outer = pitches[0] + range - pitches[N - 1];
+        for (int voice = 0; voice < N - 1; voice++) {
+            double inner = pitches[voice + 1] - pitches[voice];
+            if (!(ge_epsilon(outer, inner))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool isNormalI() const {
+        int lowerVoice = 1;
+        int upperVoice = N - 1;
+        while (lowerVoice < upperVoice) {
+            // Truncated to int, as in isNormal<EQUIVALENCE_RELATION_I>.
+            int lowerInterval = pitches[lowerVoice] - pitches[lowerVoice - 1];
+            int upperInterval = pitches[upperVoice] - pitches[upperVoice - 1];
+            if (lt_epsilon(lowerInterval, upperInterval)) {
+                return true;
+            }
+            if (gt_epsilon(lowerInterval, upperInterval)) {
+                return false;
+            }
+            lowerVoice = lowerVoice + 1;
+            upperVoice = upperVoice - 1;
+        }
+        return true;
+    }
+    bool isNormalRP(double range) const {
+        return isNormalP() && isNormalR(range);
+    }
+    bool isNormalRPI(double range) const {
+        if (isNormalRP(range) == false) {
+            return false;
+        }
+        ChordN inverse = *this;
+        inverse.I();
+        inverse.normalizeRP(range);
+        return *this <= inverse;
+    }
+    void normalizeR(double range) {
+        for (int voice = 0; voice < N; ++voice) {
+            pitches[voice] = modulo(pitches[voice], range);
+        }
+        while (lt_epsilon(layer(), range) == false) {
+            int voice = maxVoice();
+            pitches[voice] = pitches[voice] - range;
+        }
+    }
+    /**
+     * The same exchange sort as normalize<EQUIVALENCE_RELATION_P>, which
+     * the compiler can unroll for fixed N.
+     */
+    void normalizeP() {
+        bool sorted = false;
+        while (!sorted) {
+            sorted = true;
+            for (int voice = 1; voice < N; voice++) {
+                if (gt_epsilon(pitches[voice - 1], pitches[voice])) {
+                    sorted = false;
+                    swap(voice - 1, voice);
+                }
+            }
+        }
+    }
+    void normalizeT() {
+        double sumPerVoice = layer() / double(N);
+        T(-sumPerVoice);
+    }
+    void normalizeTg(double g) {
+        normalizeT();
+        double ng = std::ceil(pitches[0] / g);
+        double transposition = (ng * g) - pitches[0];
+        T(transposition);
+    }
+    void normalizeRP(double range) {
+        normalizeR(range);
+        normalizeP();
+    }
+    bool normalizeRPT(double range) {
+        normalizeRP(range);
+        ChordN voicing = *this;
+        for (int voice = 0; voice < N; voice++) {
+            if (voice > 0) {
+                voicing.v();
+            }
+            if (voicing.isNormalV(range)) {
+                *this = voicing;
+                normalizeT();
+                return true;
+            }
+        }
+        return false;
+    }
+    bool normalizeRPTg(double range, double g) {
+        normalizeRP(range);
+        ChordN voicing = *this;
+        for (int voice = 0; voice < N; voice++) {
+            if (voice > 0) {
+                voicing.v();
+            }
+            ChordN normalTg = voicing;
+            normalTg.normalizeTg(g);
+            if (normalTg.isNormalV(range) == true) {
+                *this = normalTg;
+                return true;
+            }
+        }
+        return false;
+    }
+    void normalizeRPI(double range) {
+        if (isNormalRPI(range) == true) {
+            return;
+        }
+        normalizeRP(range);
+        ChordN inverse = *this;
+        inverse.I();
+        inverse.normalizeRP(range);
+        if (!(*this <= inverse)) {
+            *this = inverse;
+        }
+    }
+    bool normalizeRPTI(double range) {
+        if (normalizeRPT(range) == false) {
+            return false;
+        }
+        if (isNormalI() == true) {
+            return true;
+        }
+        normalizeRPI(range);
+        return normalizeRPT(range);
+    }
+    bool normalizeRPTgI(double range, double g) {
+        if (normalizeRPTg(range, g) == false) {
+            return false;
+        }
+        ChordN inverse = *this;
+        inverse.I();
+        if (inverse.normalizeRPTg(range, g) == false) {
+            return false;
+        }
+        if (!(*this <= inverse)) {
+            *this = inverse;
+        }
+        return true;
+    }
+    bool operator == (const ChordN &other) const {
+        for (int voice = 0; voice < N; ++voice) {
+            if (!eq_epsilon(pitches[voice], other.pitches[voice])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator < (const ChordN &other) const {
+        for (int voice = 0; voice < N; voice++) {
+            if (lt_epsilon(pitches[voice], other.pitches[voice])) {
+                return true;
+            }
+            if (gt_epsilon(pitches[voice], other.pitches[voice])) {
+                return false;
+            }
+        }
+        return false;
+    }
+    bool operator <= (const ChordN &other) const {
+        if (*this == other) {
+            return true;
+        }
+        return *this < other;
+    }
+};
+
+/**
+ * Normalizes the chord as a ChordN<N>; returns false, leaving normal
+ * unchanged, if the relation is not implemented by ChordN.
+ */
+template<int EQUIVALENCE_RELATION, int N> inline SILENCE_PUBLIC bool normalizeFixed(const Chord &chord, double range, double g, Chord &normal) {
+    ChordN<N> fixed(chord);
+    bool normalized = false;
+    switch (EQUIVALENCE_RELATION) {
+    case EQUIVALENCE_RELATION_RP:
+        fixed.normalizeRP(range);
+        normalized = true;
+        break;
+    case EQUIVALENCE_RELATION_RPT:
+        normalized = fixed.normalizeRPT(range);
+        break;
+    case EQUIVALENCE_RELATION_RPTg:
+        normalized = fixed.normalizeRPTg(range, g);
+        break;
+    case EQUIVALENCE_RELATION_RPI:
+        fixed.normalizeRPI(range);
+        normalized = true;
+        break;
+    case EQUIVALENCE_RELATION_RPTI:
+        normalized = fixed.normalizeRPTI(range);
+        break;
+    case EQUIVALENCE_RELATION_RPTgI:
+        normalized = fixed.normalizeRPTgI(range, g);
+        break;
+    }
+    if (normalized == true) {
+        normal = fixed.toChord(chord);
+    }
+    return normalized;
+}
+
+/**
+ * Dispatches chords of 3 through 8 voices to normalizeFixed; returns false
+ * for other chords, which the caller must normalize as Chords.
+ */
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC bool normalizeFixed(const Chord &chord, double range, double g, Chord &normal) {
+    switch (chord.voices()) {
+    case 3:
+        return normalizeFixed<EQUIVALENCE_RELATION, 3>(chord, range, g, normal);
+    case 4:
+        return normalizeFixed<EQUIVALENCE_RELATION, 4>(chord, range, g, normal);
+    case 5:
+        return normalizeFixed<EQUIVALENCE_RELATION, 5>(chord, range, g, normal);
+    case 6:
+        return normalizeFixed<EQUIVALENCE_RELATION, 6>(chord, range, g, normal);
+    case 7:
+        return normalizeFixed<EQUIVALENCE_RELATION, 7>(chord, range, g, normal);
+    case 8:
+        return normalizeFixed<EQUIVALENCE_RELATION, 8>(chord, range, g, normal);
+    }
+    return false;
+}
+
+//	EQUIVALENCE_RELATION_r
+
+template<> inline SILENCE_PUBLIC bool isNormal<EQUIVALENCE_RELATION_r>(const Chord &chord, double range, double g) {
+    for (int voice = 0; voice < chord.voices(); ++voice) {
+        double pitch = chord.getPitch(voice);
+        if (le_epsilon(0.0, pitch) == false) {
+            return false;
+        }
+        if (lt_epsilon(pitch, range) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_r>(const Chord &chord, double range, double g) {
+	Chord normal = chord;
+	for (int voice = 0; voice < chord.voices(); ++voice) {
+		double pitch = chord.getPitch(voice);
+		pitch = modulo(pitch, range);
+		normal.setPitch(voice, pitch);
+	}
 	return normal;
 }
 
@@ -2286,6 +3264,51 @@ inline Chord Chord::eI() const {
     return csound::normalize<EQUIVALENCE_RELATION_I>(*this, OCTAVE(), 1.0);
 }
 
+/**
+ * A chord that is normal under P, T, or I is its own normal form, so for
+ * integral pitches each of these relations reduces to checking normality
+ * with exact arithmetic and comparing the pitches.
+ */
+template<> inline SILENCE_PUBLIC bool isEquivalent<EQUIVALENCE_RELATION_P>(const Chord &a, const Chord &b, double range, double g) {
+    if (!hasIntegralPitches(a) || !hasIntegralPitches(b)) {
+        return isEquivalentByNormalize<EQUIVALENCE_RELATION_P>(a, b, range, g);
+    }
+    for (size_t voice = 1; voice < a.voices(); ++voice) {
+        if (a.getPitch(voice - 1) > a.getPitch(voice)) {
+            return false;
+        }
+    }
+    for (size_t voice = 1; voice < b.voices(); ++voice) {
+        if (b.getPitch(voice - 1) > b.getPitch(voice)) {
+            return false;
+        }
+    }
+    return integralPitchesEqual(a, b);
+}
+
+template<> inline SILENCE_PUBLIC bool isEquivalent<EQUIVALENCE_RELATION_T>(const Chord &a, const Chord &b, double range, double g) {
+    if (!hasIntegralPitches(a) || !hasIntegralPitches(b)) {
+        return isEquivalentByNormalize<EQUIVALENCE_RELATION_T>(a, b, range, g);
+    }
+    if (a.layer() != 0.0 || b.layer() != 0.0) {
+        return false;
+    }
+    return integralPitchesEqual(a, b);
+}
+
+template<> inline SILENCE_PUBLIC bool isEquivalent<EQUIVALENCE_RELATION_I>(const Chord &a, const Chord &b, double range, double g) {
+    if (!hasIntegralPitches(a) || !hasIntegralPitches(b)) {
+        return isEquivalentByNormalize<EQUIVALENCE_RELATION_I>(a, b, range, g);
+    }
+    if (isNormal<EQUIVALENCE_RELATION_I>(a, range, g) == false) {
+        return false;
+    }
+    if (isNormal<EQUIVALENCE_RELATION_I>(b, range, g) == false) {
+        return false;
+    }
+    return integralPitchesEqual(a, b);
+}
+
 //	EQUIVALENCE_RELATION_V
 
 //  TODO: Is this correct?
@@ -2338,6 +3361,10 @@ inline bool Chord::iseRP(double range) const {
 }
 
 template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_RP>(const Chord &chord, double range, double g) {
+    Chord fixed;
+    if (normalizeFixed<EQUIVALENCE_RELATION_RP>(chord, range, g, fixed) == true) {
+        return fixed;
+    }
     Chord normal = normalize<EQUIVALENCE_RELATION_R>(chord, range, g);
     normal = normalize<EQUIVALENCE_RELATION_P>(normal, range, g);
     return normal;
@@ -2410,6 +3437,10 @@ inline bool Chord::iseRPT(double range) const {
 }
 
 template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_RPT>(const Chord &chord, double range, double g) {
+    Chord fixed;
+    if (normalizeFixed<EQUIVALENCE_RELATION_RPT>(chord, range, g, fixed) == true) {
+        return fixed;
+    }
     Chord normalRP = normalize<EQUIVALENCE_RELATION_RP>(chord, range, g);
     std::vector<Chord> voicings_ = normalRP.voicings();
     for (size_t voice = 0; voice < normalRP.voices(); voice++) {
@@ -2449,6 +3480,10 @@ inline bool Chord::iseRPTT(double range, double g) const {
 }
 
 template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_RPTg>(const Chord &chord, double range, double g) {
+    Chord fixed;
+    if (normalizeFixed<EQUIVALENCE_RELATION_RPTg>(chord, range, g, fixed) == true) {
+        return fixed;
+    }
     Chord normalRP = normalize<EQUIVALENCE_RELATION_RP>(chord, range, g);
     std::vector<Chord> voicings_ = normalRP.voicings();
     for (size_t voice = 0; voice < normalRP.voices(); voice++) {
@@ -2496,6 +3531,10 @@ inline bool Chord::iseRPI(double range) const {
 }
 
 template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_RPI>(const Chord &chord, double range, double g) {
+    Chord fixed;
+    if (normalizeFixed<EQUIVALENCE_RELATION_RPI>(chord, range, g, fixed) == true) {
+        return fixed;
+    }
     if (isNormal<EQUIVALENCE_RELATION_RPI>(chord, range, g) == true) {
         return chord;
     }
@@ -2540,6 +3579,10 @@ inline bool Chord::iseRPTI(double range) const {
 }
 
 template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_RPTI>(const Chord &chord, double range, double g) {
+    Chord fixed;
+    if (normalizeFixed<EQUIVALENCE_RELATION_RPTI>(chord, range, g, fixed) == true) {
+        return fixed;
+    }
     Chord normalRPT = normalize<EQUIVALENCE_RELATION_RPT>(chord, range, g);
     if (isNormal<EQUIVALENCE_RELATION_I>(normalRPT, range, g) == true) {
         return normalRPT;
@@ -2573,6 +3616,10 @@ inline bool Chord::iseRPTTI(double range) const {
 }
 
 template<> inline SILENCE_PUBLIC Chord normalize<EQUIVALENCE_RELATION_RPTgI>(const Chord &chord, double range, double g) {
+    Chord fixed;
+    if (normalizeFixed<EQUIVALENCE_RELATION_RPTgI>(chord, range, g, fixed) == true) {
+        return fixed;
+    }
     Chord normalRPTg = normalize<EQUIVALENCE_RELATION_RPTg>(chord, range, g);
     Chord inverse = normalRPTg.I();
     Chord inverseNormalRPTg = normalize<EQUIVALENCE_RELATION_RPTg>(inverse, range, g);
@@ -2643,6 +3690,220 @@ template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC std::set<Chord> fundame
     return fundamentalDomain;
 }
 
+/**
+ * Returns the successive pitches taken by the most significant voice of the
+ * odometer that fundamentalDomainByNormalize and fundamentalDomainByIsNormal
+ * walk, accumulated exactly as next() accumulates them.
+ */
+inline SILENCE_PUBLIC std::vector<double> leadingVoicePitches(const Chord &origin, double range, double g) {
+    std::vector<double> pitches;
+    double pitch = origin.getPitch(0);
+    while (gt_epsilon(pitch, origin.getPitch(0) + range) == false) {
+        pitches.push_back(pitch);
+        pitch = pitch + g;
+    }
+    return pitches;
+}
+
+/**
+ * Walks the part of the odometer in which the most significant voice has
+ * the given pitch, in the same order and with the same arithmetic as
+ * next(), and adds the normal form (or, if byNormalize is false, each chord
+ * that is normal) to the fundamental domain. The very first slab omits the
+ * origin itself, because next() increments before the first visit.
+ */
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC void fundamentalDomainForLeadingVoice(std::set<Chord> &fundamentalDomain, const Chord &origin, double leadingPitch, bool isFirst, double upperI, double range, double g, bool byNormalize)
+{
+    int leastSignificantVoice = origin.voices() - 1;
+    Chord chord = origin;
+    chord.setPitch(0, leadingPitch);
+    bool visit = !isFirst;
+    for (;;) {
+        if (visit == true) {
+            if (byNormalize == true) {
+                fundamentalDomain.insert(normalize<EQUIVALENCE_RELATION>(chord, range, g));
+            } else if (isNormal<EQUIVALENCE_RELATION>(chord, range, g) == true) {
+                fundamentalDomain.insert(chord);
+            }
+        }
+        visit = true;
+        // With one voice, each slab is a single chord.
+        if (leastSignificantVoice == 0) {
+            return;
+        }
+        chord.setPitch(leastSignificantVoice, chord.getPitch(leastSignificantVoice) + g);
+        for (int voice = leastSignificantVoice; voice > 0; --voice) {
+            if (gt_epsilon(chord.getPitch(voice), (origin.getPitch(voice) + upperI))) {
+                if (voice == 1) {
+                    // This would carry into the most significant voice.
+                    return;
+                }
+                chord.setPitch(voice, origin.getPitch(voice));
+                chord.setPitch(voice - 1, chord.getPitch(voice - 1) + g);
+            }
+        }
+    }
+}
+
+/**
+ * Returns the same fundamental domain as fundamentalDomainByNormalize (or,
+ * if byNormalize is false, fundamentalDomainByIsNormal), but partitions
+ * the odometer by the pitch of its most significant voice and enumerates
+ * the partitions on several threads, each into its own set. The sets are
+ * merged in odometer order, so that of two epsilon-equal chords the one
+ * enumerated first is kept, as in the serial functions, whatever the number
+ * of threads. If threads is 0, std::thread::hardware_concurrency is used.
+ */
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC std::set<Chord> parallelFundamentalDomain(int voiceN, double range, double g, bool byNormalize, unsigned threads = 0)
+{
+    int upperI = 2 * range + 1;
+    int lowerI = - (range + 1);
+    Chord origin = iterator(voiceN, lowerI);
+    // Initialize shared statics before any worker starts.
+    EPSILON();
+    std::vector<double> leadingPitches = leadingVoicePitches(origin, upperI, g);
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max(1u, std::min(threads, unsigned(leadingPitches.size())));
+    std::vector< std::set<Chord> > domains(leadingPitches.size());
+    std::vector<std::thread> workers;
+    for (unsigned worker = 0; worker < threads; ++worker) {
+        workers.push_back(std::thread([&domains, &origin, &leadingPitches, worker, threads, upperI, range, g, byNormalize]() {
+            for (size_t slab = worker; slab < leadingPitches.size(); slab += threads) {
+                fundamentalDomainForLeadingVoice<EQUIVALENCE_RELATION>(domains[slab], origin, leadingPitches[slab], slab == 0, upperI, range, g, byNormalize);
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    std::set<Chord> fundamentalDomain;
+    for (size_t slab = 0; slab < domains.size(); ++slab) {
+        fundamentalDomain.insert(domains[slab].begin(), domains[slab].end());
+    }
+    return fundamentalDomain;
+}
+
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC std::set<Chord> parallelFundamentalDomainByNormalize(int voiceN, double range, double g, unsigned threads = 0)
+{
+    return parallelFundamentalDomain<EQUIVALENCE_RELATION>(voiceN, range, g, true, threads);
+}
+
+template<int EQUIVALENCE_RELATION> inline SILENCE_PUBLIC std::set<Chord> parallelFundamentalDomainByIsNormal(int voiceN, double range, double g, unsigned threads = 0)
+{
+    return parallelFundamentalDomain<EQUIVALENCE_RELATION>(voiceN, range, g, false, threads);
+}
+
+/**
+ * The octavewise revoicings of a chord within a range, in the order in which
+ * next() enumerates them from the chord's RP form with a step of one octave.
+ * That order is a mixed-radix number: the digit for each voice is the number
+ * of octaves added to it, the last voice is the least significant, and the
+ * radix of each voice is the number of its octaves within the range. So
+ * revoicings are ranked and unranked in time proportional to the number of
+ * voices, rather than by stepping the odometer. The pitches of each digit are
+ * accumulated exactly as next() accumulates them, so the revoicings are
+ * identical to the odometer's.
+ */
+class SILENCE_PUBLIC OctavewiseRevoicings {
+public:
+    OctavewiseRevoicings() : count(1) {
+    }
+    OctavewiseRevoicings(const Chord &chord, double range) {
+        initialize(chord, range);
+    }
+    virtual ~OctavewiseRevoicings() {
+    }
+    virtual void initialize(const Chord &chord, double range) {
+        origin = csound::normalize<EQUIVALENCE_RELATION_RP>(chord, OCTAVE(), 1.0);
+        pitchesForVoices.assign(origin.voices(), std::vector<double>());
+        count = 1;
+        for (int voice = 0, voices = origin.voices(); voice < voices; ++voice) {
+            std::vector<double> &pitches = pitchesForVoices[voice];
+            double pitch = origin.getPitch(voice);
+            while (gt_epsilon(pitch, (origin.getPitch(voice) + range)) == false) {
+                pitches.push_back(pitch);
+                pitch = pitch + OCTAVE();
+            }
+            if (pitches.empty()) {
+                pitches.push_back(origin.getPitch(voice));
+            }
+            count = count * int(pitches.size());
+        }
+    }
+    /**
+     * Returns the chord's RP form, which is revoicing 0.
+     */
+    const Chord &getOrigin() const {
+        return origin;
+    }
+    /**
+     * Returns the number of revoicings, including the RP form.
+     */
+    int size() const {
+        return count;
+    }
+    /**
+     * Returns revoicing index, which must be in [0, size()).
+     */
+    Chord unrank(int index) const {
+        Chord revoicing = origin;
+        for (int voice = int(pitchesForVoices.size()) - 1; voice >= 0; --voice) {
+            const std::vector<double> &pitches = pitchesForVoices[voice];
+            int radix = pitches.size();
+            revoicing.setPitch(voice, pitches[index % radix]);
+            index = index / radix;
+        }
+        return revoicing;
+    }
+    /**
+     * Returns the index of the revoicing whose pitches equal those of the
+     * chord, or -1 if the chord is not one of the revoicings.
+     */
+    int rank(const Chord &revoicing) const {
+        if (revoicing.voices() != origin.voices()) {
+            return -1;
+        }
+        int index = 0;
+        for (int voice = 0, voices = pitchesForVoices.size(); voice < voices; ++voice) {
+            const std::vector<double> &pitches = pitchesForVoices[voice];
+            int digit = -1;
+            for (int i = 0, n = pitches.size(); i < n; ++i) {
+                if (eq_epsilon(revoicing.getPitch(voice), pitches[i])) {
+                    digit = i;
+                    break;
+                }
+            }
+            if (digit == -1) {
+                return -1;
+            }
+            index = index * int(pitches.size()) + digit;
+        }
+        return index;
+    }
+    /**
+     * Same as octavewiseRevoicing(chord, revoicingNumber, range): the
+     * number is taken modulo the number of revoicings not counting the RP
+     * form, or 1 if there are none.
+     */
+    Chord octavewiseRevoicing(int revoicingNumber) const {
+        int revoicingN = count - 1;
+        if (revoicingN == 0) {
+            revoicingN = 1;
+        }
+        int index = revoicingNumber % revoicingN;
+        if (index < 0) {
+            index = index + revoicingN;
+        }
+        return unrank(index);
+    }
+protected:
+    Chord origin;
+    std::vector< std::vector<double> > pitchesForVoices;
+    int count;
+};
+
 /**
  * Orthogonal additive groups for unordered chords of given arity under range
  * equivalence (RP): prime form or P, inversion or I, transposition or T, and
@@ -2675,18 +3936,160 @@ public:
 	 * Ordered table of all OPTTI chords for g.
 	 */
 	std::vector<Chord> opttisForIndexes;
-	std::map<Chord, int> indexesForOpttis;
+	/**
+	 * Epsilon-ordered index of opttisForIndexes, built on demand by
+	 * getIndexesForOpttis, because only chords that are off the lattice of
+	 * g need it.
+	 */
+	mutable std::map<Chord, int> indexesForOpttis;
+	mutable bool indexedOpttis;
+	std::shared_ptr<std::mutex> indexesForOpttisMutex;
+	/**
+	 * If not empty, the directory in which createChordSpaceGroup reads and
+	 * writes binary cache files; by default, no binary cache is used.
+	 */
+	std::string binaryCacheDirectory;
 	/**
 	 * Ordered table of all octavewise permutations
 	 * in RP (note: not OP).
 	 */
 	std::vector<Chord> voicingsForIndexes;
 	std::map<Chord, int> indexesForVoicings;
+	/**
+	 * The OPTgI and OP chords for one combination of P, I, and T, with the
+	 * octavewise revoicings of the OP chord.
+	 */
+	struct Revoicings {
+		Chord normalOPTgI;
+		Chord normalOP;
+		OctavewiseRevoicings revoicings;
+	};
+	/**
+	 * Table of Revoicings for each combination of P, I, and T, at index
+	 * (P * countI + I) * countT + T, filled in on demand by toChord, so that
+	 * once a combination has been used, toChord takes time proportional to N.
+	 */
+	mutable std::vector< std::shared_ptr<const Revoicings> > revoicingsForIndexes;
+	std::shared_ptr<std::mutex> revoicingsMutex;
+	ChordSpaceGroup() : N(0), g(1.0), range(OCTAVE()), countP(0), countI(2), countT(0), countV(0), indexedOpttis(true), indexesForOpttisMutex(std::make_shared<std::mutex>()), revoicingsMutex(std::make_shared<std::mutex>()) {
+	}
+	virtual ~ChordSpaceGroup() {
+	}
+	/**
+	 * Hashed index of opttisForIndexes, which finds an OPTTI in constant time
+	 * instead of by O(log n) epsilon comparisons in indexesForOpttis.
+	 */
+	std::unordered_map<QuantizedChord, int, QuantizedChord::Hash> hashedIndexesForOpttis;
+	/**
+	 * Header of the binary cache file written by saveBinary. It is followed,
+	 * in native byte order, by countP * N doubles, the pitches of each OPTTI
+	 * in index order.
+	 */
+	struct Header {
+		enum {
+			FORMAT_VERSION = 1,
+			BYTE_ORDER_MARK = 0x01020304
+		};
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrderMark;
+		int32_t N;
+		int32_t countP;
+		double range;
+		double g;
+		static const char *MAGIC() {
+			return "CSACCSG1";
+		}
+		bool isValid() const {
+			return std::memcmp(magic, MAGIC(), sizeof(magic)) == 0 &&
+				version == FORMAT_VERSION &&
+				byteOrderMark == BYTE_ORDER_MARK &&
+				N > 0 &&
+				countP >= 0 &&
+				g > 0.0 &&
+				std::isfinite(g) &&
+				std::isfinite(range);
+		}
+		/**
+		 * Returns whether the header is for the given group. range and g
+		 * are compared to 6 significant digits, the precision with which
+		 * save() writes them to the text file.
+		 */
+		bool isFor(int voices, double range_, double g_) const {
+			return N == voices &&
+				std::fabs(range - range_) <= 1e-6 * std::max(std::fabs(range), std::fabs(range_)) &&
+				std::fabs(g - g_) <= 1e-6 * std::max(std::fabs(g), std::fabs(g_));
+		}
+	};
+	/**
+	 * The pitches of a chord as integer multiples of g. Every chord in the
+	 * group lies on this lattice, so the key identifies it exactly.
+	 */
+	QuantizedChord latticeKey(const Chord &chord) const {
+		return QuantizedChord(chord, 1.0 / g);
+	}
+	/**
+	 * Rebuilds hashedIndexesForOpttis and countP from opttisForIndexes, and
+	 * discards indexesForOpttis, to be rebuilt when it is next needed.
+	 */
+	virtual void indexOpttis() {
+		{
+			std::lock_guard<std::mutex> lock(*indexesForOpttisMutex);
+			indexesForOpttis.clear();
+			indexedOpttis = false;
+		}
+		hashedIndexesForOpttis.clear();
+		hashedIndexesForOpttis.reserve(opttisForIndexes.size());
+		for (int i = 0, n = opttisForIndexes.size(); i < n; ++i) {
+			hashedIndexesForOpttis[latticeKey(opttisForIndexes[i])] = i;
+		}
+		countP = opttisForIndexes.size();
+	}
+	/**
+	 * Returns indexesForOpttis, building it first if need be.
+	 */
+	const std::map<Chord, int> &getIndexesForOpttis() const {
+		std::lock_guard<std::mutex> lock(*indexesForOpttisMutex);
+		if (!indexedOpttis) {
+			for (int i = 0, n = opttisForIndexes.size(); i < n; ++i) {
+				indexesForOpttis[opttisForIndexes[i]] = i;
+			}
+			indexedOpttis = true;
+		}
+		return indexesForOpttis;
+	}
+	/**
+	 * Returns the index of the OPTTI, or -1 if it is not in the group. The
+	 * hashed index is tried first, and its result is confirmed with
+	 * operator ==; chords that are not on the lattice of g fall back to
+	 * indexesForOpttis.
+	 */
+	int indexForOptti(const Chord &optti) const {
+		std::unordered_map<QuantizedChord, int, QuantizedChord::Hash>::const_iterator hashed = hashedIndexesForOpttis.find(latticeKey(optti));
+		if (hashed != hashedIndexesForOpttis.end() && opttisForIndexes[hashed->second] == optti) {
+			return hashed->second;
+		}
+		const std::map<Chord, int> &indexesForOpttis_ = getIndexesForOpttis();
+		std::map<Chord, int>::const_iterator it = indexesForOpttis_.find(optti);
+		if (it == indexesForOpttis_.end()) {
+			return -1;
+		}
+		return it->second;
+	}
 	virtual void preinitialize(int N_, double range_, double g_ = 1.0) {
 		opttisForIndexes.clear();
-		indexesForOpttis.clear();
+		{
+			std::lock_guard<std::mutex> lock(*indexesForOpttisMutex);
+			indexesForOpttis.clear();
+			indexedOpttis = true;
+		}
+		hashedIndexesForOpttis.clear();
 		voicingsForIndexes.clear();
 		indexesForVoicings.clear();
+		{
+			std::lock_guard<std::mutex> lock(*revoicingsMutex);
+			revoicingsForIndexes.clear();
+		}
 		N = N_;
 		range = range_;
 		g = g_;
@@ -2699,14 +4102,11 @@ public:
 	}
 	virtual void initialize(int N_, double range_, double g_ = 1.0) {
 		preinitialize(N_, range_, g_);
-        std::set<Chord> opttisForIndexes_ = fundamentalDomainByNormalize<EQUIVALENCE_RELATION_RPTgI>(N, OCTAVE(), g);
+        std::set<Chord> opttisForIndexes_ = parallelFundamentalDomainByNormalize<EQUIVALENCE_RELATION_RPTgI>(N, OCTAVE(), g);
         for (std::set<Chord>::iterator it = opttisForIndexes_.begin(); it != opttisForIndexes_.end(); ++it) {
             opttisForIndexes.push_back(*it);
         }
-		for (int i = 0, n = opttisForIndexes.size(); i < n; ++i) {
-			indexesForOpttis[opttisForIndexes[i]] = i;
-			countP = countP + 1;
-		}
+		indexOpttis();
 	}
 	virtual void list(bool listheader = true, bool listopttis = false, bool listvoicings = false) const {
 		if (listheader) {
@@ -2721,7 +4121,7 @@ public:
 		if (listopttis) {
 			for (int i = 0, n = opttisForIndexes.size(); i < n; ++i) {
 				const Chord &optti = opttisForIndexes[i];
-				int index = indexesForOpttis.at(optti);
+				int index = getIndexesForOpttis().at(optti);
 				print("index: %5d  optti: %s  index from optti: %5d  %s\n", i, optti.toString().c_str(), index, optti.name().c_str());
 			}
 		}
@@ -2741,9 +4141,30 @@ public:
 		return buffer;
 	}
 	/**
-	 * Loads the group if found, creates and saves it otherwise.
+	 * Returns the pathname of the binary cache file in binaryCacheDirectory.
+	 */
+	virtual std::string createBinaryFilename(int voices, double range, double g = 1.0) const {
+		char buffer[0x200];
+		std::sprintf(buffer, "ChordSpaceGroup_V%d_R%d_g%d.bin", voices, int(range), int(1000 * g));
+		std::string pathname = binaryCacheDirectory;
+		if (!pathname.empty() && pathname[pathname.size() - 1] != '/' && pathname[pathname.size() - 1] != '\\') {
+			pathname += '/';
+		}
+		return pathname + buffer;
+	}
+	/**
+	 * If binaryCacheDirectory is set, loads the group from its binary cache
+	 * file there if found. Otherwise, loads the group from its text file if
+	 * found, or creates and saves it, and then, if binaryCacheDirectory is
+	 * set, writes the binary cache file for next time.
 	 */
 	virtual void createChordSpaceGroup(int voices, double range, double g = 1.0) {
+		bool useBinaryCache = !binaryCacheDirectory.empty();
+		std::string binaryFilename = createBinaryFilename(voices, range, g);
+		if (useBinaryCache && loadBinary(binaryFilename, voices, range, g)) {
+			print("Loaded ChordSpaceGroup data from file \"%s\".\n", binaryFilename.c_str());
+			return;
+		}
 		std::string filename = createFilename(voices, range, g);
 		std::fstream stream;
 		stream.open(filename.c_str());
@@ -2758,6 +4179,9 @@ public:
 			load(stream);
 		}
 		stream.close();
+		if (useBinaryCache && !saveBinary(binaryFilename)) {
+			print("Could not save ChordSpaceGroup data to file \"%s\".\n", binaryFilename.c_str());
+		}
 	}
 	virtual void save(std::fstream &stream) const {
 		stream << "N " << N << std::endl;
@@ -2783,10 +4207,73 @@ public:
 			chord.fromString(buffer);
 			if (chord.voices() > 1) {
 				opttisForIndexes.push_back(chord);
-				indexesForOpttis[chord] = opttisForIndexes.size() - 1;
 			}
 		}
-		countP = opttisForIndexes.size();
+		indexOpttis();
+	}
+	/**
+	 * Saves the group to a binary cache file; returns false on error.
+	 */
+	virtual bool saveBinary(std::string filename) const {
+		FILE *file = std::fopen(filename.c_str(), "wb");
+		if (!file) {
+			return false;
+		}
+		Header header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, Header::MAGIC(), sizeof(header.magic));
+		header.version = Header::FORMAT_VERSION;
+		header.byteOrderMark = Header::BYTE_ORDER_MARK;
+		header.N = N;
+		header.countP = opttisForIndexes.size();
+		header.range = range;
+		header.g = g;
+		bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+		std::vector<double> pitches(N);
+		for (size_t i = 0, n = opttisForIndexes.size(); ok && i < n; ++i) {
+			for (int voice = 0; voice < N; ++voice) {
+				pitches[voice] = opttisForIndexes[i].getPitch(voice);
+			}
+			ok = std::fwrite(&pitches[0], sizeof(double), N, file) == size_t(N);
+		}
+		if (std::fclose(file) != 0) {
+			ok = false;
+		}
+		return ok;
+	}
+	/**
+	 * Loads the group from a binary cache file, which is mapped into memory
+	 * rather than parsed, and builds only the hashed index of the OPTTIs;
+	 * returns false, leaving the group unchanged, if the file cannot be read
+	 * or is not valid, or if voices is greater than 0 and the file is not
+	 * for the group with voices, range_, and g_.
+	 */
+	virtual bool loadBinary(std::string filename, int voices = 0, double range_ = 0.0, double g_ = 0.0) {
+		MappedFile file;
+		if (!file.open(filename) || file.size() < sizeof(Header)) {
+			return false;
+		}
+		const Header *header = (const Header *) file.data();
+		// countP is checked by division, so that a corrupt count cannot
+		// overflow the size of the data.
+		if (!header->isValid() || uint64_t(header->countP) > (file.size() - sizeof(Header)) / (uint64_t(header->N) * sizeof(double))) {
+			return false;
+		}
+		if (voices > 0 && !header->isFor(voices, range_, g_)) {
+			return false;
+		}
+		preinitialize(header->N, header->range, header->g);
+		const double *pitches = (const double *) (file.data() + sizeof(Header));
+		opttisForIndexes.resize(header->countP);
+		for (int i = 0; i < header->countP; ++i) {
+			Chord &chord = opttisForIndexes[i];
+			chord.resize(N);
+			for (int voice = 0; voice < N; ++voice) {
+				chord.setPitch(voice, pitches[size_t(i) * N + voice]);
+			}
+		}
+		indexOpttis();
+		return true;
 	}
 	/**
 	 * Returns the indices of prime form, inversion, transposition,
@@ -2798,7 +4285,9 @@ public:
 	 * belong to the same equivalence class. In such cases, although there
 	 * will aways be a mapping from each set of indices to one chord, there
 	 * may be several chords that map to the same set of indices.
-	 * The result is returned in a homogeneous vector.
+	 * The result is returned in a homogeneous vector. If the chord's OPTTI
+	 * is not in the group, which would be a bug, an error is printed and
+	 * the prime form index is -1.
 	 */
 	Eigen::VectorXi fromChord(const Chord &chord, bool printme = false) const {
             bool isNormalOP = csound::isNormal<EQUIVALENCE_RELATION_RP>(chord, OCTAVE(), g);
@@ -2838,12 +4327,11 @@ public:
             // Try iterating over opttis and comparing eO, eP, eT, eI separately.
             // Alternatively, put in same index for equivalent opttis.
             Chord normalOPTgI = csound::normalize<EQUIVALENCE_RELATION_RPTgI>(chord, OCTAVE(), g);
-            std::map<Chord, int>::const_iterator it = indexesForOpttis.find(normalOPTgI);
-            if (it == indexesForOpttis.end()) {
+            int P_ = indexForOptti(normalOPTgI);
+            if (P_ == -1) {
               // Falling through here means there is a bug that I want to know about.
-              csound::print("Error: normalOPTgI %s not found! Please report an issue, this should not appear.\n");
+              csound::print("Error: normalOPTgI %s not found! Please report an issue, this should not appear.\n", normalOPTgI.toString().c_str());
             }
-            int P_ = it->second;
             if (printme) {
               print("normalOPTgI:    %s    %d\n", normalOPTgI.toString().c_str(), P_);
             }
@@ -2888,6 +4376,31 @@ public:
 			print("BEGAN toChord()...\n");
 			print("PITV:       %8d     %8d     %8d     %8d\n", P, I, T, V);
 		}
+		std::shared_ptr<const Revoicings> revoicings_ = revoicings(P, I, T, printme);
+		Chord revoicing = revoicings_->revoicings.octavewiseRevoicing(V);
+		std::vector<Chord> result(3);
+		result[0] = revoicing;
+		result[1] = revoicings_->normalOPTgI;
+		result[2] = revoicings_->normalOP;
+		if (printme) {
+			print("revoicing:      %s\n", result[0].toString().c_str());
+			print("ENDED toChord().\n");
+		}
+		return result;
+	}
+	/**
+	 * Returns the Revoicings for P, I, and T, from revoicingsForIndexes if
+	 * they are there, and otherwise computes and stores them.
+	 */
+	std::shared_ptr<const Revoicings> revoicings(int P, int I, int T, bool printme = false) const {
+		size_t index = (size_t(P) * countI + I) * countT + T;
+		if (!printme) {
+			std::lock_guard<std::mutex> lock(*revoicingsMutex);
+			if (index < revoicingsForIndexes.size() && revoicingsForIndexes[index]) {
+				return revoicingsForIndexes[index];
+			}
+		}
+		std::shared_ptr<Revoicings> revoicings_ = std::make_shared<Revoicings>();
 		Chord normalOPTgI = opttisForIndexes[P];
 		if (printme) {
 			print("normalOPTgI:    %s\n", normalOPTgI.toString().c_str());
@@ -2910,16 +4423,15 @@ public:
 		if (printme) {
 			print("normalOP:       %s\n", normalOP.toString().c_str());
 		}
-		Chord revoicing = octavewiseRevoicing(normalOP, V, range, printme);
-		std::vector<Chord> result(3);
-		result[0] = revoicing;
-		result[1] = normalOPTgI;
-		result[2] = normalOP;
-		if (printme) {
-			print("revoicing:      %s\n", result[0].toString().c_str());
-			print("ENDED toChord().\n");
+		revoicings_->normalOPTgI = normalOPTgI;
+		revoicings_->normalOP = normalOP;
+		revoicings_->revoicings.initialize(normalOP, range);
+		std::lock_guard<std::mutex> lock(*revoicingsMutex);
+		if (revoicingsForIndexes.size() < size_t(countP) * countI * countT) {
+			revoicingsForIndexes.resize(size_t(countP) * countI * countT);
 		}
-		return result;
+		revoicingsForIndexes[index] = revoicings_;
+		return revoicings_;
 	}
 	std::vector<Chord> toChord(const Eigen::VectorXi &pitv, bool printme = false) const {
 		return toChord(pitv(0), pitv(1), pitv(2), pitv(3), printme);
@@ -2987,32 +4499,29 @@ inline std::string Chord::information() const {
 		return buffer;
 	}
 
+inline SILENCE_PUBLIC int octavewiseRevoicings(const Chord &chord,
+                                               double range) {
+    OctavewiseRevoicings revoicings(chord, range);
+    int voicings = revoicings.size() - 1;
+    if (debug) {
+      print("octavewiseRevoicings: chord:    %s\n", chord.toString().c_str());
+      print("octavewiseRevoicings: eop:      %s\n", revoicings.getOrigin().toString().c_str());
+      print("octavewiseRevoicings: voicings: %5d\n", voicings);
+    }
+    return voicings;
+}
+
 inline SILENCE_PUBLIC Chord octavewiseRevoicing(const Chord &chord, int revoicingNumber_, double range, bool debug) {
-    int revoicingN = octavewiseRevoicings(chord, range); 
-    if (revoicingN == 0) {
-        revoicingN = 1;
-    }        
-    int revoicingNumber = revoicingNumber_ % revoicingN;
-    Chord origin = csound::normalize<EQUIVALENCE_RELATION_RP>(chord, OCTAVE(), 1.0);
-    Chord revoicing = origin;
-    int revoicingI = 0;
-    while (true) {
-        if (debug) {
-            print("octavewiseRevoicing %d (%d) of %s in range %7.3f: %5d: %s\n",
-                revoicingNumber,
-                revoicingNumber_,
-                chord.toString().c_str(),
-                range,
-                revoicingI,
-                revoicing.toString().c_str());
-        }
-        if (revoicingI == revoicingNumber) {
-            return revoicing;
-        }
-        (void) next(revoicing, origin, range, OCTAVE());
-        revoicingI++;
+    OctavewiseRevoicings revoicings(chord, range);
+    Chord revoicing = revoicings.octavewiseRevoicing(revoicingNumber_);
+    if (debug) {
+        print("octavewiseRevoicing %d of %s in range %7.3f: %s\n",
+            revoicingNumber_,
+            chord.toString().c_str(),
+            range,
+            revoicing.toString().c_str());
     }
-    return origin;
+    return revoicing;
 }
 
 /**
@@ -3021,28 +4530,16 @@ inline SILENCE_PUBLIC Chord octavewiseRevoicing(const Chord &chord, int revoicin
  * -1 if there is no such chord within the range.
  */
 inline SILENCE_PUBLIC int indexForOctavewiseRevoicing(const Chord &chord, double range, bool debug) {
-	int revoicingN = octavewiseRevoicings(chord, range);
-    Chord origin = csound::normalize<EQUIVALENCE_RELATION_RP>(chord, OCTAVE(), 1.0);
-	Chord revoicing = origin;
-    int revoicingI = 0;
-    while (true) {
-        if (debug) {
-            print("indexForOctavewiseRevoicing of %s in range %7.3f: %5d of %5d: %s\n",
-                chord.toString().c_str(),
-                range,
-                revoicingI,
-                revoicingN,
-                revoicing.toString().c_str());
-        }
-        if (revoicing == chord) {
-            return revoicingI;
-        }
-        (void) next(revoicing, origin, range, OCTAVE());
-        revoicingI++;
-        if (revoicingI > revoicingN) {
-            return -1;
-        }
+    OctavewiseRevoicings revoicings(chord, range);
+    int revoicingI = revoicings.rank(chord);
+    if (debug) {
+        print("indexForOctavewiseRevoicing of %s in range %7.3f: %5d of %5d\n",
+            chord.toString().c_str(),
+            range,
+            revoicingI,
+            revoicings.size() - 1);
     }
+    return revoicingI;
 }
 
 } // End of namespace csound.
@@ -0,0 +1,550 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef COLUMNARSCORE_H
+#define COLUMNARSCORE_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include "Score.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+%}
+%include "std_string.i"
+%include "std_vector.i"
+#else
+#include "Score.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+#endif
+
+namespace csound
+{
+  class ColumnarScore;
+
+  /**
+   * A reference to one event of a ColumnarScore, with the same accessors
+   * as Event, so that code written against Events can read and write the
+   * columns in place. A view is only valid until the score is resized,
+   * sorted, or destroyed.
+   */
+  template<typename ScorePointer>
+  class BasicColumnarEventView
+  {
+  protected:
+    ScorePointer score;
+    size_t index;
+  public:
+    BasicColumnarEventView(ScorePointer score_, size_t index_) : score(score_), index(index_)
+    {
+    }
+    size_t getIndex() const
+    {
+      return index;
+    }
+    double operator[](int dimension) const;
+    double getTime() const
+    {
+      return (*this)[Event::TIME];
+    }
+    double getDuration() const
+    {
+      return (*this)[Event::DURATION];
+    }
+    double getOffTime() const
+    {
+      return getTime() + getDuration();
+    }
+    double getStatus() const
+    {
+      return (*this)[Event::STATUS];
+    }
+    double getInstrument() const
+    {
+      return (*this)[Event::INSTRUMENT];
+    }
+    double getKey() const
+    {
+      return (*this)[Event::KEY];
+    }
+    double getVelocity() const
+    {
+      return (*this)[Event::VELOCITY];
+    }
+    double getPhase() const
+    {
+      return (*this)[Event::PHASE];
+    }
+    double getPan() const
+    {
+      return (*this)[Event::PAN];
+    }
+    double getDepth() const
+    {
+      return (*this)[Event::DEPTH];
+    }
+    double getHeight() const
+    {
+      return (*this)[Event::HEIGHT];
+    }
+    double getPitches() const
+    {
+      return (*this)[Event::PITCHES];
+    }
+    /**
+     * As Event::isNote(): true if the MIDI status nibble is note on and
+     * the velocity, rounded, is greater than zero, whatever the channel.
+     */
+    bool isNote() const
+    {
+      return (int(std::floor(getStatus() + 0.5)) & 0xf0) == 144 &&
+        int(std::floor(getVelocity() + 0.5)) > 0;
+    }
+    std::string getProperty(std::string name) const;
+    /**
+     * Copies this event, with its properties, into a new Event.
+     */
+    Event toEvent() const;
+    operator Event() const
+    {
+      return toEvent();
+    }
+  };
+
+  typedef BasicColumnarEventView<const ColumnarScore *> ConstColumnarEventView;
+
+  /**
+   * A mutable reference to one event of a ColumnarScore.
+   */
+  class SILENCE_PUBLIC ColumnarEventView :
+    public BasicColumnarEventView<ColumnarScore *>
+  {
+  public:
+    ColumnarEventView(ColumnarScore *score_, size_t index_) : BasicColumnarEventView<ColumnarScore *>(score_, index_)
+    {
+    }
+    operator ConstColumnarEventView() const
+    {
+      return ConstColumnarEventView(score, index);
+    }
+    double &operator[](int dimension);
+    double operator[](int dimension) const
+    {
+      return BasicColumnarEventView<ColumnarScore *>::operator[](dimension);
+    }
+    void setTime(double time)
+    {
+      (*this)[Event::TIME] = time;
+    }
+    void setDuration(double duration)
+    {
+      (*this)[Event::DURATION] = duration;
+    }
+    void setOffTime(double offTime)
+    {
+      setDuration(offTime - getTime());
+    }
+    void setStatus(double status)
+    {
+      (*this)[Event::STATUS] = status;
+    }
+    void setInstrument(double instrument)
+    {
+      (*this)[Event::INSTRUMENT] = instrument;
+    }
+    void setKey(double key)
+    {
+      (*this)[Event::KEY] = key;
+    }
+    void setVelocity(double velocity)
+    {
+      (*this)[Event::VELOCITY] = velocity;
+    }
+    void setPhase(double phase)
+    {
+      (*this)[Event::PHASE] = phase;
+    }
+    void setPan(double pan)
+    {
+      (*this)[Event::PAN] = pan;
+    }
+    void setDepth(double depth)
+    {
+      (*this)[Event::DEPTH] = depth;
+    }
+    void setHeight(double height)
+    {
+      (*this)[Event::HEIGHT] = height;
+    }
+    void setPitches(double pitches)
+    {
+      (*this)[Event::PITCHES] = pitches;
+    }
+    void setProperty(std::string name, std::string value);
+    void removeProperty(std::string name);
+    /**
+     * Overwrites this event, with its properties, from an Event.
+     */
+    ColumnarEventView &operator = (const Event &event);
+  };
+
+  /**
+   * A collection of events in music space stored as a structure of arrays:
+   * each dimension of Event (TIME, DURATION, KEY, VELOCITY...) is kept in
+   * its own contiguous, aligned column. Appending an event costs no heap
+   * allocation once the columns are reserved, and transforms that touch
+   * only a few dimensions of many events read only those columns, which
+   * can be processed as Eigen vectors.
+   * <p>
+   * Properties are rare, so they are stored sparsely by event index.
+   * <p>
+   * Existing code that works on Events can use the views returned by
+   * operator[], or convert to and from Score with fromScore() and toScore().
+   */
+  class SILENCE_PUBLIC ColumnarScore
+  {
+  public:
+    typedef std::vector<double, Eigen::aligned_allocator<double> > Column;
+    typedef Eigen::Map<Eigen::VectorXd, Eigen::Aligned16> ColumnMap;
+    typedef Eigen::Map<const Eigen::VectorXd, Eigen::Aligned16> ConstColumnMap;
+  protected:
+    Column columns[Event::ELEMENT_COUNT];
+    std::map<size_t, std::map<std::string, std::string> > properties;
+    friend class BasicColumnarEventView<ColumnarScore *>;
+    friend class BasicColumnarEventView<const ColumnarScore *>;
+    friend class ColumnarEventView;
+  public:
+    ColumnarScore()
+    {
+    }
+    ColumnarScore(const Score &score)
+    {
+      fromScore(score);
+    }
+    virtual ~ColumnarScore()
+    {
+    }
+    size_t size() const
+    {
+      return columns[0].size();
+    }
+    bool empty() const
+    {
+      return columns[0].empty();
+    }
+    void reserve(size_t count)
+    {
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        columns[dimension].reserve(count);
+      }
+    }
+    /**
+     * Resizes the score; new events are zero, except for the
+     * pitch-class set, which is 4095 as in Event.
+     */
+    void resize(size_t count)
+    {
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        columns[dimension].resize(count, dimension == Event::PITCHES ? 4095.0 : 0.0);
+      }
+      properties.erase(properties.lower_bound(count), properties.end());
+    }
+    void clear()
+    {
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        columns[dimension].clear();
+      }
+      properties.clear();
+    }
+    ColumnarEventView operator[](size_t index)
+    {
+      return ColumnarEventView(this, index);
+    }
+    ConstColumnarEventView operator[](size_t index) const
+    {
+      return ConstColumnarEventView(this, index);
+    }
+    /**
+     * Returns the values of one dimension for all events.
+     */
+    Column &column(int dimension)
+    {
+      return columns[dimension];
+    }
+    const Column &column(int dimension) const
+    {
+      return columns[dimension];
+    }
+    /**
+     * Returns one dimension for all events as an aligned Eigen vector,
+     * for vectorized transforms, e.g. score.map(Event::KEY).array() += 12.
+     */
+    ColumnMap map(int dimension)
+    {
+      return ColumnMap(columns[dimension].data(), (Eigen::Index) size());
+    }
+    ConstColumnMap map(int dimension) const
+    {
+      return ConstColumnMap(columns[dimension].data(), (Eigen::Index) size());
+    }
+    void append(const Event &event)
+    {
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        columns[dimension].push_back(dimension < event.size() ? event[dimension] : 0.0);
+      }
+      if (!event.properties.empty()) {
+        properties[size() - 1] = event.properties;
+      }
+    }
+    void append(double time, double duration, double status, double instrument, double key, double velocity, double phase=0, double pan=0, double depth=0, double height=0, double pitches=4095)
+    {
+      columns[Event::TIME].push_back(time);
+      columns[Event::DURATION].push_back(duration);
+      columns[Event::STATUS].push_back(status);
+      columns[Event::INSTRUMENT].push_back(instrument);
+      columns[Event::KEY].push_back(key);
+      columns[Event::VELOCITY].push_back(velocity);
+      columns[Event::PHASE].push_back(phase);
+      columns[Event::PAN].push_back(pan);
+      columns[Event::DEPTH].push_back(depth);
+      columns[Event::HEIGHT].push_back(height);
+      columns[Event::PITCHES].push_back(pitches);
+      columns[Event::HOMOGENEITY].push_back(0.0);
+    }
+    /**
+     * Replaces the contents of this with the events of the score.
+     */
+    void fromScore(const Score &score)
+    {
+      clear();
+      reserve(score.size());
+      for (size_t i = 0, n = score.size(); i < n; ++i) {
+        append(score[i]);
+      }
+    }
+    /**
+     * Appends the events of this, with their properties, to the score.
+     */
+    void toScore(Score &score) const
+    {
+      score.reserve(score.size() + size());
+      for (size_t i = 0, n = size(); i < n; ++i) {
+        score.push_back((*this)[i].toEvent());
+      }
+    }
+    /**
+     * Returns the latest off time of any event minus the earliest time,
+     * as Score::getDuration does.
+     */
+    double getDuration() const
+    {
+      if (empty()) {
+        return 0.0;
+      }
+      double start = map(Event::TIME).minCoeff();
+      double end = (map(Event::TIME) + map(Event::DURATION)).maxCoeff();
+      return end - start;
+    }
+    /**
+     * Returns the minimum and range of one dimension over [beginAt, endAt).
+     */
+    void getScale(int dimension, size_t beginAt, size_t endAt, double &minimum, double &range) const
+    {
+      endAt = std::min(endAt, size());
+      if (beginAt >= endAt) {
+        minimum = 0.0;
+        range = 0.0;
+        return;
+      }
+      ConstColumnMap values = map(dimension);
+      Eigen::Index count = (Eigen::Index) (endAt - beginAt);
+      minimum = values.segment((Eigen::Index) beginAt, count).minCoeff();
+      double maximum = values.segment((Eigen::Index) beginAt, count).maxCoeff();
+      range = maximum - minimum;
+    }
+    /**
+     * Moves and/or scales one dimension over [beginAt, endAt) to the target
+     * minimum and range, with the same semantics as Score::setScale.
+     */
+    void setScale(int dimension, bool rescaleMinimum, bool rescaleRange, size_t beginAt, size_t endAt, double targetMinimum, double targetRange)
+    {
+      if (!(rescaleMinimum || rescaleRange)) {
+        return;
+      }
+      endAt = std::min(endAt, size());
+      if (beginAt >= endAt) {
+        return;
+      }
+      double actualMinimum = 0.0;
+      double actualRange = 0.0;
+      getScale(dimension, beginAt, endAt, actualMinimum, actualRange);
+      double scale = 1.0;
+      if (rescaleRange && actualRange != 0.0) {
+        scale = targetRange / actualRange;
+      }
+      if (!rescaleMinimum) {
+        targetMinimum = actualMinimum;
+      }
+      Eigen::Index count = (Eigen::Index) (endAt - beginAt);
+      ColumnMap values = map(dimension);
+      values.segment((Eigen::Index) beginAt, count).array() =
+        (values.segment((Eigen::Index) beginAt, count).array() - actualMinimum) * scale + targetMinimum;
+    }
+    /**
+     * Sorts the events by the dimensions in Event::SORT_ORDER, keeping
+     * the original order of equal events.
+     */
+    void sort()
+    {
+      size_t n = size();
+      std::vector<size_t> order(n);
+      for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+      }
+      std::stable_sort(order.begin(), order.end(), SortOrderLess(this));
+      permute(order);
+    }
+    /**
+     * Rearranges the events so that event i becomes the event that was
+     * at order[i].
+     */
+    void permute(const std::vector<size_t> &order)
+    {
+      Column buffer(order.size());
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        const Column &source = columns[dimension];
+        for (size_t i = 0, n = order.size(); i < n; ++i) {
+          buffer[i] = source[order[i]];
+        }
+        columns[dimension].swap(buffer);
+      }
+      if (!properties.empty()) {
+        std::map<size_t, std::map<std::string, std::string> > permuted;
+        for (size_t i = 0, n = order.size(); i < n; ++i) {
+          std::map<size_t, std::map<std::string, std::string> >::iterator it = properties.find(order[i]);
+          if (it != properties.end()) {
+            permuted[i].swap(it->second);
+          }
+        }
+        properties.swap(permuted);
+      }
+    }
+  protected:
+    struct SortOrderLess
+    {
+      const ColumnarScore *score;
+      SortOrderLess(const ColumnarScore *score_) : score(score_)
+      {
+      }
+      bool operator()(size_t a, size_t b) const
+      {
+        for (int i = 0; i < Event::HOMOGENEITY; ++i) {
+          const Column &values = score->columns[Event::SORT_ORDER[i]];
+          if (values[a] < values[b]) {
+            return true;
+          } else if (values[b] < values[a]) {
+            return false;
+          }
+        }
+        return false;
+      }
+    };
+  };
+
+  template<typename ScorePointer>
+  inline double BasicColumnarEventView<ScorePointer>::operator[](int dimension) const
+  {
+    return score->columns[dimension][index];
+  }
+
+  template<typename ScorePointer>
+  inline std::string BasicColumnarEventView<ScorePointer>::getProperty(std::string name) const
+  {
+    std::map<size_t, std::map<std::string, std::string> >::const_iterator it = score->properties.find(index);
+    if (it == score->properties.end()) {
+      return "";
+    }
+    std::map<std::string, std::string>::const_iterator property = it->second.find(name);
+    if (property == it->second.end()) {
+      return "";
+    }
+    return property->second;
+  }
+
+  template<typename ScorePointer>
+  inline Event BasicColumnarEventView<ScorePointer>::toEvent() const
+  {
+    Event event;
+    event.resize(Event::ELEMENT_COUNT);
+    for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+      event[dimension] = (*this)[dimension];
+    }
+    std::map<size_t, std::map<std::string, std::string> >::const_iterator it = score->properties.find(index);
+    if (it != score->properties.end()) {
+      event.properties = it->second;
+    }
+    return event;
+  }
+
+  inline double &ColumnarEventView::operator[](int dimension)
+  {
+    return score->columns[dimension][index];
+  }
+
+  inline void ColumnarEventView::setProperty(std::string name, std::string value)
+  {
+    score->properties[index][name] = value;
+  }
+
+  inline void ColumnarEventView::removeProperty(std::string name)
+  {
+    std::map<size_t, std::map<std::string, std::string> >::iterator it = score->properties.find(index);
+    if (it != score->properties.end()) {
+      it->second.erase(name);
+      if (it->second.empty()) {
+        score->properties.erase(it);
+      }
+    }
+  }
+
+  inline ColumnarEventView &ColumnarEventView::operator = (const Event &event)
+  {
+    for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+      (*this)[dimension] = dimension < event.size() ? event[dimension] : 0.0;
+    }
+    if (event.properties.empty()) {
+      score->properties.erase(index);
+    } else {
+      score->properties[index] = event.properties;
+    }
+    return *this;
+  }
+}
+#endif
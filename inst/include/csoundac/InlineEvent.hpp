@@ -0,0 +1,373 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef INLINEEVENT_H
+#define INLINEEVENT_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include "Score.hpp"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/StdVector>
+%}
+%include "std_string.i"
+%include "std_vector.i"
+#else
+#include "Score.hpp"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/StdVector>
+#endif
+
+namespace csound
+{
+  /**
+   * Properties of an InlineEvent. Nothing is allocated until the first
+   * property is set, and copies share one map until one of them is
+   * changed (copy on write), so copying an event without properties,
+   * which is nearly every event, costs no allocation.
+   */
+  class SILENCE_PUBLIC InlineEventProperties
+  {
+  public:
+    typedef std::map<std::string, std::string> Map;
+  protected:
+    std::shared_ptr<Map> map;
+    Map &mutableMap()
+    {
+      if (!map) {
+        map = std::make_shared<Map>();
+      } else if (map.use_count() > 1) {
+        map = std::make_shared<Map>(*map);
+      }
+      return *map;
+    }
+  public:
+    bool empty() const
+    {
+      return !map || map->empty();
+    }
+    size_t size() const
+    {
+      return map ? map->size() : 0;
+    }
+    std::string get(const std::string &name) const
+    {
+      if (!map) {
+        return "";
+      }
+      Map::const_iterator it = map->find(name);
+      if (it == map->end()) {
+        return "";
+      }
+      return it->second;
+    }
+    void set(const std::string &name, const std::string &value)
+    {
+      mutableMap()[name] = value;
+    }
+    void remove(const std::string &name)
+    {
+      if (map && map->find(name) != map->end()) {
+        mutableMap().erase(name);
+      }
+    }
+    void clear()
+    {
+      map.reset();
+    }
+    /**
+     * Copies the properties into a std::map, as stored in Event.
+     */
+    Map toMap() const
+    {
+      return map ? *map : Map();
+    }
+    void fromMap(const Map &properties)
+    {
+      if (properties.empty()) {
+        map.reset();
+      } else {
+        map = std::make_shared<Map>(properties);
+      }
+    }
+  };
+
+  /**
+   * An event in music space with the same dimensions and accessors as
+   * Event, but stored in a fixed size, aligned, inline vector instead of
+   * a heap allocated Eigen::VectorXd, and with lazily allocated, shared
+   * properties. Copying or moving an InlineEvent is a copy of 12 doubles
+   * that Eigen vectorizes, plus a null or shared pointer.
+   * <p>
+   * Event is unchanged, so as not to break the binary interface of the
+   * library; use InlineEvent and InlineScore for code that copies or
+   * sorts many events, and convert to and from Event and Score at the
+   * boundaries.
+   */
+  class SILENCE_PUBLIC InlineEvent :
+    public Eigen::Matrix<double, Event::ELEMENT_COUNT, 1>
+  {
+  public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    typedef Eigen::Matrix<double, Event::ELEMENT_COUNT, 1> Vector;
+    InlineEventProperties properties;
+    InlineEvent()
+    {
+      initialize();
+    }
+    InlineEvent(double time, double duration, double status, double instrument, double key, double velocity, double phase=0, double pan=0, double depth=0, double height=0, double pitches=4095)
+    {
+      set(time, duration, status, instrument, key, velocity, phase, pan, depth, height, pitches);
+    }
+    explicit InlineEvent(const Event &event)
+    {
+      fromEvent(event);
+    }
+    template<typename OtherDerived>
+    InlineEvent(const Eigen::MatrixBase<OtherDerived> &other) : Vector(other)
+    {
+    }
+    template<typename OtherDerived>
+    InlineEvent &operator = (const Eigen::MatrixBase<OtherDerived> &other)
+    {
+      Vector::operator=(other);
+      return *this;
+    }
+    void initialize()
+    {
+      setZero();
+      (*this)[Event::PITCHES] = 4095.0;
+    }
+    void set(double time, double duration, double status, double instrument, double key, double velocity, double phase=0, double pan=0, double depth=0, double height=0, double pitches=4095)
+    {
+      (*this)[Event::TIME] = time;
+      (*this)[Event::DURATION] = duration;
+      (*this)[Event::STATUS] = status;
+      (*this)[Event::INSTRUMENT] = instrument;
+      (*this)[Event::KEY] = key;
+      (*this)[Event::VELOCITY] = velocity;
+      (*this)[Event::PHASE] = phase;
+      (*this)[Event::PAN] = pan;
+      (*this)[Event::DEPTH] = depth;
+      (*this)[Event::HEIGHT] = height;
+      (*this)[Event::PITCHES] = pitches;
+      (*this)[Event::HOMOGENEITY] = 0.0;
+    }
+    /**
+     * Copies an Event, with its properties, into this.
+     */
+    void fromEvent(const Event &event)
+    {
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        (*this)[dimension] = dimension < event.size() ? event[dimension] : 0.0;
+      }
+      properties.fromMap(event.properties);
+    }
+    /**
+     * Copies this, with its properties, into a new Event.
+     */
+    Event toEvent() const
+    {
+      Event event;
+      event.resize(Event::ELEMENT_COUNT);
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        event[dimension] = (*this)[dimension];
+      }
+      event.properties = properties.toMap();
+      return event;
+    }
+    double getTime() const
+    {
+      return (*this)[Event::TIME];
+    }
+    void setTime(double time)
+    {
+      (*this)[Event::TIME] = time;
+    }
+    double getDuration() const
+    {
+      return (*this)[Event::DURATION];
+    }
+    void setDuration(double duration)
+    {
+      (*this)[Event::DURATION] = duration;
+    }
+    double getOffTime() const
+    {
+      return getTime() + getDuration();
+    }
+    void setOffTime(double offTime)
+    {
+      setDuration(offTime - getTime());
+    }
+    double getStatus() const
+    {
+      return (*this)[Event::STATUS];
+    }
+    void setStatus(double status)
+    {
+      (*this)[Event::STATUS] = status;
+    }
+    double getInstrument() const
+    {
+      return (*this)[Event::INSTRUMENT];
+    }
+    void setInstrument(double instrument)
+    {
+      (*this)[Event::INSTRUMENT] = instrument;
+    }
+    double getKey() const
+    {
+      return (*this)[Event::KEY];
+    }
+    void setKey(double key)
+    {
+      (*this)[Event::KEY] = key;
+    }
+    double getVelocity() const
+    {
+      return (*this)[Event::VELOCITY];
+    }
+    void setVelocity(double velocity)
+    {
+      (*this)[Event::VELOCITY] = velocity;
+    }
+    double getPhase() const
+    {
+      return (*this)[Event::PHASE];
+    }
+    void setPhase(double phase)
+    {
+      (*this)[Event::PHASE] = phase;
+    }
+    double getPan() const
+    {
+      return (*this)[Event::PAN];
+    }
+    void setPan(double pan)
+    {
+      (*this)[Event::PAN] = pan;
+    }
+    double getDepth() const
+    {
+      return (*this)[Event::DEPTH];
+    }
+    void setDepth(double depth)
+    {
+      (*this)[Event::DEPTH] = depth;
+    }
+    double getHeight() const
+    {
+      return (*this)[Event::HEIGHT];
+    }
+    void setHeight(double height)
+    {
+      (*this)[Event::HEIGHT] = height;
+    }
+    double getPitches() const
+    {
+      return (*this)[Event::PITCHES];
+    }
+    void setPitches(double pitches)
+    {
+      (*this)[Event::PITCHES] = pitches;
+    }
+    /**
+     * As Event::isNote(): true if the MIDI status nibble is note on and
+     * the velocity, rounded, is greater than zero, whatever the channel.
+     */
+    bool isNote() const
+    {
+      return (int(std::floor(getStatus() + 0.5)) & 0xf0) == 144 &&
+        int(std::floor(getVelocity() + 0.5)) > 0;
+    }
+    std::string getProperty(std::string name) const
+    {
+      return properties.get(name);
+    }
+    void setProperty(std::string name, std::string value)
+    {
+      properties.set(name, value);
+    }
+    void removeProperty(std::string name)
+    {
+      properties.remove(name);
+    }
+    void clearProperties()
+    {
+      properties.clear();
+    }
+  };
+
+  /**
+   * Orders InlineEvents by the dimensions in Event::SORT_ORDER, as Events are.
+   */
+  inline bool operator < (const InlineEvent &a, const InlineEvent &b)
+  {
+    for (int i = 0; i < Event::HOMOGENEITY; ++i) {
+      int dimension = Event::SORT_ORDER[i];
+      if (a[dimension] < b[dimension]) {
+        return true;
+      } else if (b[dimension] < a[dimension]) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * A sequence of InlineEvents, with the allocator Eigen requires for
+   * aligned fixed size members.
+   */
+  typedef std::vector<InlineEvent, Eigen::aligned_allocator<InlineEvent> > InlineScore;
+
+  /**
+   * Appends the events of a Score to an InlineScore.
+   */
+  inline void toInlineScore(const Score &score, InlineScore &inlineScore)
+  {
+    inlineScore.reserve(inlineScore.size() + score.size());
+    for (size_t i = 0, n = score.size(); i < n; ++i) {
+      inlineScore.push_back(InlineEvent(score[i]));
+    }
+  }
+
+  /**
+   * Appends the events of an InlineScore to a Score.
+   */
+  inline void fromInlineScore(const InlineScore &inlineScore, Score &score)
+  {
+    score.reserve(score.size() + inlineScore.size());
+    for (size_t i = 0, n = inlineScore.size(); i < n; ++i) {
+      score.push_back(inlineScore[i].toEvent());
+    }
+  }
+}
+#endif
@@ -0,0 +1,154 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include <stdint.h>
+#include <string>
+%}
+%include "std_string.i"
+#else
+#include <stdint.h>
+#include <string>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace csound
+{
+  /**
+   * A whole file mapped read-only into memory, with mmap or, on Windows,
+   * a file mapping object. The mapping is released when the object is
+   * closed or destroyed.
+   */
+  class SILENCE_PUBLIC MappedFile
+  {
+  protected:
+    const char *data_;
+    uint64_t length;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+  public:
+    MappedFile() : data_(0), length(0)
+#if defined(_WIN32)
+      , file(INVALID_HANDLE_VALUE), mapping(0)
+#endif
+    {
+    }
+    virtual ~MappedFile()
+    {
+      close();
+    }
+    /**
+     * Maps the file; returns false if it does not exist, is empty, or
+     * cannot be mapped.
+     */
+    bool open(std::string filename)
+    {
+      close();
+#if defined(_WIN32)
+      file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+      if (file == INVALID_HANDLE_VALUE) {
+        return false;
+      }
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        close();
+        return false;
+      }
+      length = uint64_t(size.QuadPart);
+      mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+      if (!mapping) {
+        close();
+        return false;
+      }
+      data_ = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+      int descriptor = ::open(filename.c_str(), O_RDONLY);
+      if (descriptor < 0) {
+        return false;
+      }
+      struct stat status;
+      if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        ::close(descriptor);
+        return false;
+      }
+      length = uint64_t(status.st_size);
+      void *address = mmap(0, size_t(length), PROT_READ, MAP_SHARED, descriptor, 0);
+      ::close(descriptor);
+      data_ = address == MAP_FAILED ? 0 : (const char *) address;
+#endif
+      if (!data_) {
+        close();
+        return false;
+      }
+      return true;
+    }
+    void close()
+    {
+#if defined(_WIN32)
+      if (data_) {
+        UnmapViewOfFile(data_);
+      }
+      if (mapping) {
+        CloseHandle(mapping);
+      }
+      if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+      }
+      mapping = 0;
+      file = INVALID_HANDLE_VALUE;
+#else
+      if (data_) {
+        munmap((void *) data_, size_t(length));
+      }
+#endif
+      data_ = 0;
+      length = 0;
+    }
+    bool isOpen() const
+    {
+      return data_ != 0;
+    }
+    const char *data() const
+    {
+      return data_;
+    }
+    uint64_t size() const
+    {
+      return length;
+    }
+  private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator = (const MappedFile &);
+  };
+}
+#endif
@@ -0,0 +1,210 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PITCHCLASSMASK_H
+#define PITCHCLASSMASK_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+%}
+%include "std_vector.i"
+#else
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+#endif
+
+namespace csound
+{
+  /**
+   * Tables for pitch-class sets in 12-tone equal temperament represented as
+   * 12-bit masks, in which bit pc is set if the set contains pitch-class
+   * pc. This is the same number as Voicelead::pitchClassSetToM. The tables
+   * are computed once, on first use, and are then read-only, so they may be
+   * used from any number of threads.
+   */
+  class SILENCE_PUBLIC PitchClassMasks
+  {
+  public:
+    enum
+      {
+        DIVISIONS = 12,
+        COUNT = 4096,
+        ALL = 4095
+      };
+    /**
+     * The number of pitch-classes in each set.
+     */
+    uint8_t cardinalities[COUNT];
+    /**
+     * The least rotation of each set, by lexicographicLess, i.e. the
+     * representative of its transpositional set class.
+     */
+    uint16_t primesT[COUNT];
+    /**
+     * The number of semitones by which the prime must be transposed to
+     * obtain the set.
+     */
+    uint8_t transpositionsT[COUNT];
+    /**
+     * The lesser of the primes of each set and of its inversion, i.e. the
+     * representative of its transpositional and inversional set class.
+     */
+    uint16_t primesTI[COUNT];
+    static const PitchClassMasks &instance()
+    {
+      static const PitchClassMasks masks;
+      return masks;
+    }
+    /**
+     * Transposes the set up by semitones, by rotating its bits.
+     */
+    static uint16_t rotate(uint16_t mask, int semitones)
+    {
+      semitones = ((semitones % DIVISIONS) + DIVISIONS) % DIVISIONS;
+      return uint16_t(((mask << semitones) | (mask >> (DIVISIONS - semitones))) & ALL);
+    }
+    /**
+     * Returns whether the ascending pitch-classes of a precede those of b
+     * in lexicographic order, for sets of the same cardinality: that is,
+     * whether the lowest pitch-class in which they differ belongs to a.
+     */
+    static bool lexicographicLess(uint16_t a, uint16_t b)
+    {
+      int difference = a ^ b;
+      return (a & (difference & -difference)) != 0;
+    }
+    /**
+     * Inverts the set about pitch-class 0.
+     */
+    static uint16_t invert(uint16_t mask)
+    {
+      uint16_t inverse = 0;
+      for (int pc = 0; pc < DIVISIONS; ++pc) {
+        if (mask & (1 << pc)) {
+          inverse |= uint16_t(1 << ((DIVISIONS - pc) % DIVISIONS));
+        }
+      }
+      return inverse;
+    }
+    int cardinality(uint16_t mask) const
+    {
+      return cardinalities[mask & ALL];
+    }
+    uint16_t primeT(uint16_t mask) const
+    {
+      return primesT[mask & ALL];
+    }
+    int transpositionT(uint16_t mask) const
+    {
+      return transpositionsT[mask & ALL];
+    }
+    uint16_t primeTI(uint16_t mask) const
+    {
+      return primesTI[mask & ALL];
+    }
+  protected:
+    PitchClassMasks()
+    {
+      for (int mask = 0; mask < COUNT; ++mask) {
+        int cardinality = 0;
+        for (int pc = 0; pc < DIVISIONS; ++pc) {
+          if (mask & (1 << pc)) {
+            ++cardinality;
+          }
+        }
+        cardinalities[mask] = uint8_t(cardinality);
+        uint16_t prime = uint16_t(mask);
+        int transposition = 0;
+        for (int semitones = 1; semitones < DIVISIONS; ++semitones) {
+          // The prime transposed up by t is the set, so the prime is the
+          // set transposed down by t.
+          uint16_t rotation = rotate(uint16_t(mask), -semitones);
+          if (lexicographicLess(rotation, prime)) {
+            prime = rotation;
+            transposition = semitones;
+          }
+        }
+        primesT[mask] = prime;
+        transpositionsT[mask] = uint8_t(transposition);
+      }
+      for (int mask = 0; mask < COUNT; ++mask) {
+        uint16_t inversePrime = primesT[invert(uint16_t(mask))];
+        primesTI[mask] = lexicographicLess(inversePrime, primesT[mask]) ? inversePrime : primesT[mask];
+      }
+    }
+  };
+
+  /**
+   * Returns the pitch-class of a pitch that is a whole number of semitones,
+   * in [0, 12).
+   */
+  inline SILENCE_PUBLIC int integralPitchClass(double pitch)
+  {
+    int pc = int(std::fmod(pitch, double(PitchClassMasks::DIVISIONS)));
+    return pc < 0 ? pc + PitchClassMasks::DIVISIONS : pc;
+  }
+
+  /**
+   * Returns whether the pitch is exactly a whole number of semitones that
+   * fits in an int, for which the integer kernels give the same results as
+   * the floating-point code.
+   */
+  inline SILENCE_PUBLIC bool isIntegralPitch(double pitch)
+  {
+    return pitch == std::floor(pitch) && std::fabs(pitch) < 1.0e9;
+  }
+
+  /**
+   * Computes the pitch-class set mask of the pitches; returns false, leaving
+   * mask unchanged, if any pitch is not a whole number of semitones.
+   */
+  inline SILENCE_PUBLIC bool pitchClassMask(const std::vector<double> &pitches, uint16_t &mask)
+  {
+    uint16_t result = 0;
+    for (size_t i = 0, n = pitches.size(); i < n; ++i) {
+      if (!isIntegralPitch(pitches[i])) {
+        return false;
+      }
+      result |= uint16_t(1 << integralPitchClass(pitches[i]));
+    }
+    mask = result;
+    return true;
+  }
+
+  /**
+   * Returns the pitch-classes of the mask in ascending order.
+   */
+  inline SILENCE_PUBLIC std::vector<double> maskToPitchClasses(uint16_t mask)
+  {
+    std::vector<double> pcs;
+    pcs.reserve(PitchClassMasks::instance().cardinality(mask));
+    for (int pc = 0; pc < PitchClassMasks::DIVISIONS; ++pc) {
+      if (mask & (1 << pc)) {
+        pcs.push_back(double(pc));
+      }
+    }
+    return pcs;
+  }
+}
+#endif
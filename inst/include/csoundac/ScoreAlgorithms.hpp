@@ -0,0 +1,375 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SCOREALGORITHMS_H
+#define SCOREALGORITHMS_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include "ColumnarScore.hpp"
+#include "InlineEvent.hpp"
+#include "Score.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+%}
+#else
+#include "ColumnarScore.hpp"
+#include "InlineEvent.hpp"
+#include "Score.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+#include <vector>
+#include <eigen3/Eigen/Dense>
+#endif
+
+namespace csound
+{
+  /**
+   * The sort key of one event: its first three dimensions in
+   * Event::SORT_ORDER (time, then instrument and key by default), and its
+   * index in the score.
+   */
+  struct SILENCE_PUBLIC ScoreSortKey
+  {
+    double keys[3];
+    size_t index;
+  };
+
+  /**
+   * Orders sort keys as operator < orders Events, comparing the full
+   * events only when the extracted keys are equal, and keeping the
+   * original order of equal events.
+   */
+  struct SILENCE_PUBLIC ScoreSortKeyLess
+  {
+    const Score *score;
+    ScoreSortKeyLess(const Score *score_) : score(score_)
+    {
+    }
+    bool operator()(const ScoreSortKey &a, const ScoreSortKey &b) const
+    {
+      for (int i = 0; i < 3; ++i) {
+        if (a.keys[i] < b.keys[i]) {
+          return true;
+        } else if (b.keys[i] < a.keys[i]) {
+          return false;
+        }
+      }
+      const Event &eventA = (*score)[a.index];
+      const Event &eventB = (*score)[b.index];
+      if (eventA < eventB) {
+        return true;
+      } else if (eventB < eventA) {
+        return false;
+      }
+      return a.index < b.index;
+    }
+  };
+
+  /**
+   * Returns the permutation that sorts the score as Score::sort does:
+   * element i of the result is the index of the event that belongs at
+   * position i. The sort keys are extracted into a compact array, which
+   * is sorted in parallel chunks that are then merged in parallel. Equal
+   * events keep their original order, so the result is deterministic for
+   * any number of threads. If threads is 0, the hardware concurrency is
+   * used; small scores are sorted on the calling thread.
+   */
+  inline SILENCE_PUBLIC std::vector<size_t> sortPermutation(const Score &score, unsigned threads = 0)
+  {
+    size_t n = score.size();
+    std::vector<ScoreSortKey> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+      const Event &event = score[i];
+      for (int k = 0; k < 3; ++k) {
+        keys[i].keys[k] = event[Event::SORT_ORDER[k]];
+      }
+      keys[i].index = i;
+    }
+    ScoreSortKeyLess less(&score);
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t minimumChunk = 1 << 15;
+    size_t chunks = std::min<size_t>(threads, n / minimumChunk);
+    if (chunks < 2) {
+      std::sort(keys.begin(), keys.end(), less);
+    } else {
+      std::vector<size_t> bounds(chunks + 1);
+      for (size_t c = 0; c <= chunks; ++c) {
+        bounds[c] = n * c / chunks;
+      }
+      std::vector<std::thread> workers;
+      for (size_t c = 0; c < chunks; ++c) {
+        workers.push_back(std::thread([&keys, &bounds, less, c]() {
+          std::sort(keys.begin() + bounds[c], keys.begin() + bounds[c + 1], less);
+        }));
+      }
+      for (size_t c = 0; c < workers.size(); ++c) {
+        workers[c].join();
+      }
+      // Merge neighbouring runs pairwise until one run remains.
+      for (size_t width = 1; width < chunks; width *= 2) {
+        workers.clear();
+        for (size_t c = 0; c + width < chunks; c += 2 * width) {
+          size_t begin = bounds[c];
+          size_t middle = bounds[c + width];
+          size_t end = bounds[std::min(c + 2 * width, chunks)];
+          workers.push_back(std::thread([&keys, less, begin, middle, end]() {
+            std::inplace_merge(keys.begin() + begin, keys.begin() + middle, keys.begin() + end, less);
+          }));
+        }
+        for (size_t c = 0; c < workers.size(); ++c) {
+          workers[c].join();
+        }
+      }
+    }
+    std::vector<size_t> permutation(n);
+    for (size_t i = 0; i < n; ++i) {
+      permutation[i] = keys[i].index;
+    }
+    return permutation;
+  }
+
+  /**
+   * Rearranges the events of the score so that event i becomes the event
+   * that was at permutation[i], copying each event once.
+   */
+  inline SILENCE_PUBLIC void applyPermutation(Score &score, const std::vector<size_t> &permutation)
+  {
+    std::vector<Event> permuted;
+    permuted.reserve(permutation.size());
+    for (size_t i = 0, n = permutation.size(); i < n; ++i) {
+      permuted.push_back(score[permutation[i]]);
+    }
+    score.std::vector<Event>::swap(permuted);
+  }
+
+  /**
+   * Sorts the score into the same order as Score::sort, but by sorting
+   * extracted keys in parallel and moving the events only once; see
+   * sortPermutation.
+   */
+  inline SILENCE_PUBLIC void parallelSort(Score &score, unsigned threads = 0)
+  {
+    applyPermutation(score, sortPermutation(score, threads));
+  }
+
+  /**
+   * One value for each dimension of an Event.
+   */
+  typedef Eigen::Array<double, Event::ELEMENT_COUNT, 1> ScoreDimensions;
+
+  /**
+   * Finds the minimum and range of every dimension of the score in one
+   * pass, reducing all twelve dimensions of each event at once with
+   * fixed size Eigen arrays instead of one virtual accessor call per
+   * event and dimension. An empty score has minima and ranges of 0.
+   */
+  inline SILENCE_PUBLIC void findScale(const Score &score, ScoreDimensions &minima, ScoreDimensions &ranges)
+  {
+    ScoreDimensions maxima;
+    minima.setConstant(DBL_MAX);
+    maxima.setConstant(-DBL_MAX);
+    for (size_t i = 0, n = score.size(); i < n; ++i) {
+      const Event &event = score[i];
+      if (event.size() == Event::ELEMENT_COUNT) {
+        Eigen::Map<const ScoreDimensions> values(event.data());
+        minima = minima.min(values);
+        maxima = maxima.max(values);
+      } else {
+        for (int dimension = 0; dimension < event.size() && dimension < Event::ELEMENT_COUNT; ++dimension) {
+          minima[dimension] = std::min(minima[dimension], event[dimension]);
+          maxima[dimension] = std::max(maxima[dimension], event[dimension]);
+        }
+      }
+    }
+    if (score.empty()) {
+      minima.setZero();
+      maxima.setZero();
+    }
+    ranges = maxima - minima;
+  }
+
+  inline SILENCE_PUBLIC void findScale(const InlineScore &score, ScoreDimensions &minima, ScoreDimensions &ranges)
+  {
+    ScoreDimensions maxima;
+    minima.setConstant(DBL_MAX);
+    maxima.setConstant(-DBL_MAX);
+    for (size_t i = 0, n = score.size(); i < n; ++i) {
+      minima = minima.min(score[i].array());
+      maxima = maxima.max(score[i].array());
+    }
+    if (score.empty()) {
+      minima.setZero();
+      maxima.setZero();
+    }
+    ranges = maxima - minima;
+  }
+
+  inline SILENCE_PUBLIC void findScale(const ColumnarScore &score, ScoreDimensions &minima, ScoreDimensions &ranges)
+  {
+    for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+      score.getScale(dimension, 0, score.size(), minima[dimension], ranges[dimension]);
+    }
+  }
+
+  /**
+   * Computes the coefficients of the affine map
+   * (value - origin) * scale + target that Score::setScale applies to each
+   * dimension: a dimension that is rescaled moves its actual minimum (the
+   * origin) to the target minimum and/or stretches its actual range to the
+   * target range; other dimensions have a scale of 1, and an origin and
+   * target of 0. The origin is subtracted first, as in Score::setScale, so
+   * that large offsets do not cancel.
+   */
+  inline SILENCE_PUBLIC void rescaleCoefficients(const ScoreDimensions &actualMinima,
+                                                 const ScoreDimensions &actualRanges,
+                                                 const std::vector<bool> &rescaleMinima,
+                                                 const std::vector<bool> &rescaleRanges,
+                                                 const ScoreDimensions &targetMinima,
+                                                 const ScoreDimensions &targetRanges,
+                                                 ScoreDimensions &scale,
+                                                 ScoreDimensions &origin,
+                                                 ScoreDimensions &target)
+  {
+    for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+      bool rescaleMinimum = dimension < int(rescaleMinima.size()) && rescaleMinima[dimension];
+      bool rescaleRange = dimension < int(rescaleRanges.size()) && rescaleRanges[dimension];
+      scale[dimension] = 1.0;
+      origin[dimension] = 0.0;
+      target[dimension] = 0.0;
+      if (!(rescaleMinimum || rescaleRange)) {
+        continue;
+      }
+      if (rescaleRange && actualRanges[dimension] != 0.0) {
+        scale[dimension] = targetRanges[dimension] / actualRanges[dimension];
+      }
+      origin[dimension] = actualMinima[dimension];
+      target[dimension] = rescaleMinimum ? targetMinima[dimension] : actualMinima[dimension];
+    }
+  }
+
+  /**
+   * Applies (value - origin) * scale + target to every dimension of every
+   * event in one fused pass.
+   */
+  inline SILENCE_PUBLIC void rescale(Score &score, const ScoreDimensions &scale, const ScoreDimensions &origin, const ScoreDimensions &target)
+  {
+    for (size_t i = 0, n = score.size(); i < n; ++i) {
+      Event &event = score[i];
+      if (event.size() == Event::ELEMENT_COUNT) {
+        Eigen::Map<ScoreDimensions> values(event.data());
+        values = (values - origin) * scale + target;
+      } else {
+        for (int dimension = 0; dimension < event.size() && dimension < Event::ELEMENT_COUNT; ++dimension) {
+          event[dimension] = (event[dimension] - origin[dimension]) * scale[dimension] + target[dimension];
+        }
+      }
+    }
+  }
+
+  inline SILENCE_PUBLIC void rescale(InlineScore &score, const ScoreDimensions &scale, const ScoreDimensions &origin, const ScoreDimensions &target)
+  {
+    for (size_t i = 0, n = score.size(); i < n; ++i) {
+      score[i].array() = (score[i].array() - origin) * scale + target;
+    }
+  }
+
+  inline SILENCE_PUBLIC void rescale(ColumnarScore &score, const ScoreDimensions &scale, const ScoreDimensions &origin, const ScoreDimensions &target)
+  {
+    for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+      if (scale[dimension] != 1.0 || origin[dimension] != target[dimension]) {
+        score.map(dimension).array() = (score.map(dimension).array() - origin[dimension]) * scale[dimension] + target[dimension];
+      }
+    }
+  }
+
+  /**
+   * As Score::findScale, storing the minimum and range of each dimension
+   * in scaleActualMinima and scaleActualRanges, but in one vectorized pass.
+   */
+  inline SILENCE_PUBLIC void findScale(Score &score)
+  {
+    ScoreDimensions minima;
+    ScoreDimensions ranges;
+    findScale((const Score &) score, minima, ranges);
+    score.scaleActualMinima.resize(Event::ELEMENT_COUNT);
+    score.scaleActualRanges.resize(Event::ELEMENT_COUNT);
+    for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+      score.scaleActualMinima[dimension] = minima[dimension];
+      score.scaleActualRanges[dimension] = ranges[dimension];
+    }
+  }
+
+  /**
+   * As Score::rescale(), moving and/or stretching each dimension selected
+   * by rescaleMinima and rescaleRanges to scaleTargetMinima and
+   * scaleTargetRanges, but with one vectorized pass to find the scale and
+   * one to apply it.
+   */
+  inline SILENCE_PUBLIC void rescale(Score &score)
+  {
+    findScale(score);
+    ScoreDimensions actualMinima;
+    ScoreDimensions actualRanges;
+    ScoreDimensions targetMinima;
+    ScoreDimensions targetRanges;
+    for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+      actualMinima[dimension] = score.scaleActualMinima[dimension];
+      actualRanges[dimension] = score.scaleActualRanges[dimension];
+      targetMinima[dimension] = dimension < score.scaleTargetMinima.size() ? score.scaleTargetMinima[dimension] : 0.0;
+      targetRanges[dimension] = dimension < score.scaleTargetRanges.size() ? score.scaleTargetRanges[dimension] : 0.0;
+    }
+    ScoreDimensions scale;
+    ScoreDimensions origin;
+    ScoreDimensions target;
+    rescaleCoefficients(actualMinima, actualRanges, score.rescaleMinima, score.rescaleRanges, targetMinima, targetRanges, scale, origin, target);
+    rescale(score, scale, origin, target);
+  }
+
+  /**
+   * As Score::rescale(int, bool, double, bool, double), for one dimension.
+   */
+  inline SILENCE_PUBLIC void rescale(Score &score, int dimension, bool rescaleMinimum, double minimum, bool rescaleRange = false, double range = 0.0)
+  {
+    ScoreDimensions actualMinima;
+    ScoreDimensions actualRanges;
+    findScale((const Score &) score, actualMinima, actualRanges);
+    std::vector<bool> rescaleMinima(Event::ELEMENT_COUNT, false);
+    std::vector<bool> rescaleRanges(Event::ELEMENT_COUNT, false);
+    rescaleMinima[dimension] = rescaleMinimum;
+    rescaleRanges[dimension] = rescaleRange;
+    ScoreDimensions targetMinima = ScoreDimensions::Zero();
+    ScoreDimensions targetRanges = ScoreDimensions::Zero();
+    targetMinima[dimension] = minimum;
+    targetRanges[dimension] = range;
+    ScoreDimensions scale;
+    ScoreDimensions origin;
+    ScoreDimensions target;
+    rescaleCoefficients(actualMinima, actualRanges, rescaleMinima, rescaleRanges, targetMinima, targetRanges, scale, origin, target);
+    rescale(score, scale, origin, target);
+  }
+}
+#endif
@@ -0,0 +1,1128 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SCOREIO_H
+#define SCOREIO_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include "ColumnarScore.hpp"
+#include "MappedFile.hpp"
+#include "Score.hpp"
+#include "csound.h"
+#include <algorithm>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+%}
+%include "std_string.i"
+#else
+#include "ColumnarScore.hpp"
+#include "MappedFile.hpp"
+#include "Score.hpp"
+#include "csound.h"
+#include <algorithm>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+#endif
+
+namespace csound
+{
+  /**
+   * Writes the number at p in the shortest form that reads back to the
+   * same double, using std::to_chars where the standard library provides
+   * it for floating point, or else with 17 significant digits; p must have
+   * room for 31 characters. Returns the new end.
+   */
+  inline SILENCE_PUBLIC char *formatScoreNumber(char *p, double value)
+  {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    return std::to_chars(p, p + 31, value).ptr;
+#else
+    int length = std::snprintf(p, 31, "%.17g", value);
+    return p + (length > 0 ? std::min(length, 30) : 0);
+#endif
+  }
+
+  /**
+   * Parses the whole of [begin, end) as a number in the "C" locale,
+   * whatever the current locale is; returns false if it is not one.
+   */
+  inline SILENCE_PUBLIC bool parseScoreNumber(const char *begin, const char *end, double &value)
+  {
+    if (begin < end && *begin == '+') {
+      ++begin;
+    }
+    if (begin == end) {
+      return false;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+#else
+    // strtod uses the decimal point of the current locale, so it is given
+    // a copy of the token with that decimal point.
+    char buffer[64];
+    size_t length = size_t(end - begin);
+    if (length >= sizeof(buffer)) {
+      return false;
+    }
+    char decimalPoint = std::localeconv()->decimal_point[0];
+    for (size_t i = 0; i < length; ++i) {
+      buffer[i] = begin[i] == '.' ? decimalPoint : begin[i];
+    }
+    buffer[length] = '\0';
+    char *parsed = 0;
+    value = std::strtod(buffer, &parsed);
+    return parsed == buffer + length;
+#endif
+  }
+
+  /**
+   * The instrument reassignments, gains, and pans of a Score (see
+   * Score::arrange) compiled into dense arrays indexed by instrument
+   * number, so that arranging an event costs three array reads instead of
+   * three std::map lookups. Instruments without an arrangement keep their
+   * number, velocity, and pan; in particular, an instrument number that
+   * is not reassigned, such as a fractional, tagged number, is never
+   * changed.
+   */
+  class SILENCE_PUBLIC ArrangementTable
+  {
+  protected:
+    std::vector<double> instruments;
+    std::vector<char> hasReassignments;
+    std::vector<double> gains;
+    std::vector<double> pans;
+    std::vector<char> hasPans;
+    void ensure(int instrument)
+    {
+      if (instrument >= int(instruments.size())) {
+        size_t size = size_t(instrument) + 1;
+        instruments.resize(size, 0.0);
+        hasReassignments.resize(size, 0);
+        gains.resize(size, 0.0);
+        pans.resize(size, 0.0);
+        hasPans.resize(size, 0);
+      }
+    }
+  public:
+    ArrangementTable()
+    {
+    }
+    ArrangementTable(const Score &score)
+    {
+      compile(score);
+    }
+    virtual ~ArrangementTable()
+    {
+    }
+    /**
+     * Replaces the table with the arrangement of the score.
+     */
+    void compile(const Score &score)
+    {
+      clear();
+      std::map<int, double>::const_iterator it;
+      for (it = score.reassignments.begin(); it != score.reassignments.end(); ++it) {
+        if (it->first >= 0) {
+          ensure(it->first);
+          instruments[it->first] = it->second;
+          hasReassignments[it->first] = 1;
+        }
+      }
+      for (it = score.gains.begin(); it != score.gains.end(); ++it) {
+        if (it->first >= 0) {
+          ensure(it->first);
+          gains[it->first] = it->second;
+        }
+      }
+      for (it = score.pans.begin(); it != score.pans.end(); ++it) {
+        if (it->first >= 0) {
+          ensure(it->first);
+          pans[it->first] = it->second;
+          hasPans[it->first] = 1;
+        }
+      }
+    }
+    void clear()
+    {
+      instruments.clear();
+      hasReassignments.clear();
+      gains.clear();
+      pans.clear();
+      hasPans.clear();
+    }
+    bool empty() const
+    {
+      return instruments.empty();
+    }
+    void arrange(int oldInstrumentNumber, int newInstrumentNumber)
+    {
+      ensure(oldInstrumentNumber);
+      instruments[oldInstrumentNumber] = newInstrumentNumber;
+      hasReassignments[oldInstrumentNumber] = 1;
+    }
+    void arrange(int oldInstrumentNumber, int newInstrumentNumber, double gain)
+    {
+      arrange(oldInstrumentNumber, newInstrumentNumber);
+      gains[oldInstrumentNumber] = gain;
+    }
+    void arrange(int oldInstrumentNumber, int newInstrumentNumber, double gain, double pan)
+    {
+      arrange(oldInstrumentNumber, newInstrumentNumber, gain);
+      pans[oldInstrumentNumber] = pan;
+      hasPans[oldInstrumentNumber] = 1;
+    }
+    /**
+     * Arranges one event's instrument number, velocity, and pan in place.
+     */
+    void apply(double &instrument, double &velocity, double &pan) const
+    {
+      int index = int(instrument);
+      if (index < 0 || index >= int(instruments.size())) {
+        return;
+      }
+      if (hasReassignments[index]) {
+        instrument = instruments[index];
+      }
+      velocity += gains[index];
+      if (hasPans[index]) {
+        pan = pans[index];
+      }
+    }
+    /**
+     * Arranges every event of a columnar score in one pass over the
+     * instrument, velocity, and pan columns.
+     */
+    void apply(ColumnarScore &score) const
+    {
+      if (empty()) {
+        return;
+      }
+      double *instrument = score.column(Event::INSTRUMENT).data();
+      double *velocity = score.column(Event::VELOCITY).data();
+      double *pan = score.column(Event::PAN).data();
+      for (size_t i = 0, n = score.size(); i < n; ++i) {
+        apply(instrument[i], velocity[i], pan[i]);
+      }
+    }
+    /**
+     * Returns Csound score text with the arrangement applied to p1
+     * (instrument), p5 (velocity), and p7 (pan) of each "i" statement,
+     * in the layout written by CsoundScoreWriter. Only the fields that the
+     * arrangement changes are rewritten, in the shortest form that reads
+     * back to the same double; all other text is copied unchanged, so a
+     * score written once without an arrangement can be re-arranged any
+     * number of times without formatting it again.
+     */
+    std::string apply(const std::string &text) const
+    {
+      std::string result;
+      result.reserve(text.size() + text.size() / 8);
+      size_t position = 0;
+      while (position < text.size()) {
+        size_t end = text.find('\n', position);
+        if (end == std::string::npos) {
+          end = text.size();
+        } else {
+          ++end;
+        }
+        applyToStatement(text.data() + position, text.data() + end, result);
+        position = end;
+      }
+      return result;
+    }
+  protected:
+    void applyToStatement(const char *begin, const char *end, std::string &result) const
+    {
+      const char *p = begin;
+      while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+      }
+      if (empty() || p == end || *p != 'i') {
+        result.append(begin, end);
+        return;
+      }
+      // Find p1 through p7.
+      const char *fieldBegins[7];
+      const char *fieldEnds[7];
+      const char *q = p + 1;
+      int count = 0;
+      for (; count < 7; ++count) {
+        while (q < end && (*q == ' ' || *q == '\t')) {
+          ++q;
+        }
+        if (q == end || *q == '\n' || *q == '\r' || *q == ';') {
+          break;
+        }
+        fieldBegins[count] = q;
+        while (q < end && *q != ' ' && *q != '\t' && *q != '\n' && *q != '\r') {
+          ++q;
+        }
+        fieldEnds[count] = q;
+      }
+      if (count == 0) {
+        result.append(begin, end);
+        return;
+      }
+      double instrument = 0.0;
+      if (!parseScoreNumber(fieldBegins[0], fieldEnds[0], instrument)) {
+        result.append(begin, end);
+        return;
+      }
+      int index = int(instrument);
+      if (index < 0 || index >= int(instruments.size())) {
+        result.append(begin, end);
+        return;
+      }
+      double velocity = 0.0;
+      double pan = 0.0;
+      bool changed[7] = {false, false, false, false, false, false, false};
+      changed[0] = hasReassignments[index] != 0;
+      changed[4] = count > 4 && gains[index] != 0.0 && parseScoreNumber(fieldBegins[4], fieldEnds[4], velocity);
+      changed[6] = count > 6 && hasPans[index] != 0;
+      apply(instrument, velocity, pan);
+      char buffer[32];
+      const char *copied = begin;
+      for (int field = 0; field < count; ++field) {
+        if (!changed[field]) {
+          continue;
+        }
+        double value = field == 0 ? instrument : (field == 4 ? velocity : pan);
+        result.append(copied, fieldBegins[field]);
+        result.append(buffer, formatScoreNumber(buffer, value));
+        copied = fieldEnds[field];
+      }
+      result.append(copied, end);
+    }
+  };
+
+  /**
+   * Translates a Score to Csound "i" statements, as Score::getCsoundScore
+   * does, but formatting numbers directly into preallocated buffers, in
+   * parallel chunks of events, instead of through iostreams and temporary
+   * strings. Each statement has the fields of Event::toCsoundIStatement:
+   * instrument, time, duration, key, velocity, depth, pan, height, phase,
+   * and pitch-class set. Numbers are written in the shortest form that
+   * reads back to the same double, using std::to_chars where the standard
+   * library provides it for floating point, or else with 17 significant
+   * digits.
+   * <p>
+   * Only note on events are written. The instrument reassignments, gains,
+   * and pans of the score are applied, through an ArrangementTable, unless
+   * arrange is false; the key is tempered to
+   * tonesPerOctave unless that is zero, and pitches are conformed to the
+   * pitch-class set of each event if conformPitches is true.
+   * <p>
+   * The text can be returned as one string, written to a stdio stream or
+   * a file descriptor, sent to a running Csound with csoundReadScore, or
+   * passed chunk by chunk to any function taking (const char *, size_t).
+   */
+  class SILENCE_PUBLIC CsoundScoreWriter
+  {
+  public:
+    double tonesPerOctave;
+    bool conformPitches;
+    bool arrange;
+    /**
+     * Number of formatting threads; 0 for the hardware concurrency.
+     */
+    unsigned threads;
+    /**
+     * Number of events formatted by one thread at a time.
+     */
+    size_t chunkSize;
+    /**
+     * Upper bound on the length of one formatted statement.
+     */
+    enum
+      {
+        MAXIMUM_STATEMENT = 16 + 10 * 32
+      };
+    CsoundScoreWriter(double tonesPerOctave_ = 12.0, bool conformPitches_ = false, unsigned threads_ = 0) :
+      tonesPerOctave(tonesPerOctave_),
+      conformPitches(conformPitches_),
+      arrange(true),
+      threads(threads_),
+      chunkSize(1 << 16)
+    {
+    }
+    virtual ~CsoundScoreWriter()
+    {
+    }
+    /**
+     * Writes a space and the number at p, and returns the new end.
+     */
+    static char *formatNumber(char *p, double value)
+    {
+      *p++ = ' ';
+      return formatScoreNumber(p, value);
+    }
+    /**
+     * Formats one event as an "i" statement at buffer, which must have
+     * room for MAXIMUM_STATEMENT characters, and returns the length
+     * written, which is 0 if the event is not a note on event.
+     */
+    size_t formatEvent(const ArrangementTable &table, const Event &event_, char *buffer) const
+    {
+      if (!event_.isNoteOn()) {
+        return 0;
+      }
+      if (conformPitches) {
+        Event conformed(event_);
+        conformed.conformToPitchClassSet();
+        return formatStatement(table, &conformed, buffer);
+      }
+      return formatStatement(table, &event_, buffer);
+    }
+    /**
+     * Appends the statements for events [begin, end) of the score to text.
+     */
+    void formatChunk(const Score &score, const ArrangementTable &table, size_t begin, size_t end, std::string &text) const
+    {
+      size_t length = text.size();
+      text.resize(length + (end - begin) * MAXIMUM_STATEMENT);
+      for (size_t i = begin; i < end; ++i) {
+        length += formatEvent(table, score[i], &text[length]);
+      }
+      text.resize(length);
+    }
+  protected:
+    size_t formatStatement(const ArrangementTable &table, const Event *event, char *buffer) const
+    {
+      double insno = event->getInstrument();
+      double velocity = event->getVelocity();
+      double pan = event->getPan();
+      table.apply(insno, velocity, pan);
+      char *p = buffer;
+      *p++ = 'i';
+      p = formatNumber(p, insno);
+      p = formatNumber(p, event->getTime());
+      p = formatNumber(p, event->getDuration());
+      p = formatNumber(p, tonesPerOctave == 0.0 ? event->getKey() : event->getKey(tonesPerOctave));
+      p = formatNumber(p, velocity);
+      p = formatNumber(p, event->getDepth());
+      p = formatNumber(p, pan);
+      p = formatNumber(p, event->getHeight());
+      p = formatNumber(p, event->getPhase());
+      p = formatNumber(p, event->getPitches());
+      *p++ = '\n';
+      return size_t(p - buffer);
+    }
+  public:
+    /**
+     * Formats the score and passes the text to sink, which is called as
+     * sink(const char *data, size_t length) on the calling thread, in
+     * order, once per chunk. At most threads chunks are held in memory.
+     * Returns false as soon as sink returns false.
+     */
+    template<typename Sink>
+    bool write(const Score &score, Sink sink) const
+    {
+      size_t n = score.size();
+      size_t chunk = std::max<size_t>(1, chunkSize);
+      unsigned threads_ = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+      std::vector<std::string> texts(threads_);
+      ArrangementTable table;
+      if (arrange) {
+        table.compile(score);
+      }
+      for (size_t begin = 0; begin < n; begin += chunk * threads_) {
+        size_t chunks = std::min<size_t>(threads_, (n - begin + chunk - 1) / chunk);
+        std::vector<std::thread> workers;
+        for (size_t c = 1; c < chunks; ++c) {
+          size_t chunkBegin = begin + c * chunk;
+          size_t chunkEnd = std::min(n, chunkBegin + chunk);
+          std::string *text = &texts[c];
+          text->clear();
+          workers.push_back(std::thread([this, &score, &table, chunkBegin, chunkEnd, text]() {
+            formatChunk(score, table, chunkBegin, chunkEnd, *text);
+          }));
+        }
+        texts[0].clear();
+        formatChunk(score, table, begin, std::min(n, begin + chunk), texts[0]);
+        for (size_t c = 0; c < workers.size(); ++c) {
+          workers[c].join();
+        }
+        for (size_t c = 0; c < chunks; ++c) {
+          if (!texts[c].empty() && !sink(texts[c].data(), texts[c].size())) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+    /**
+     * Returns the whole score as one string.
+     */
+    std::string toString(const Score &score) const
+    {
+      std::string result;
+      result.reserve(score.size() * 64);
+      write(score, [&result](const char *data, size_t length) {
+        result.append(data, length);
+        return true;
+      });
+      return result;
+    }
+    /**
+     * Writes the score to a stdio stream; returns false on error.
+     */
+    bool write(const Score &score, FILE *file) const
+    {
+      return write(score, [file](const char *data, size_t length) {
+        return std::fwrite(data, 1, length, file) == length;
+      });
+    }
+    /**
+     * Writes the score to a file descriptor; returns false on error.
+     */
+    bool writeToDescriptor(const Score &score, int descriptor) const
+    {
+      return write(score, [descriptor](const char *data, size_t length) {
+        while (length > 0) {
+#if defined(_WIN32)
+          int written = _write(descriptor, data, (unsigned int) std::min<size_t>(length, 1 << 30));
+#else
+          ssize_t written = ::write(descriptor, data, length);
+#endif
+          if (written <= 0) {
+            return false;
+          }
+          data += written;
+          length -= size_t(written);
+        }
+        return true;
+      });
+    }
+    /**
+     * Sends the score to Csound one chunk at a time with csoundReadScore,
+     * without building the whole score text. Returns 0 on success, or the
+     * first non-zero result of csoundReadScore.
+     */
+    int readScore(const Score &score, CSOUND *csound) const
+    {
+      int result = 0;
+      std::string statement;
+      write(score, [csound, &result, &statement](const char *data, size_t length) {
+        statement.assign(data, length);
+        result = csoundReadScore(csound, statement.c_str());
+        return result == 0;
+      });
+      return result;
+    }
+  };
+
+  /**
+   * Header of the binary score format. The file holds, in native byte
+   * order: this header; then, for each of the Event::ELEMENT_COUNT
+   * dimensions in order, eventCount doubles; then, if flags has
+   * HAS_TIME_INDEX, eventCount uint64_t indexes of the events in order of
+   * start time. Each array begins at a multiple of ALIGNMENT bytes, so the
+   * file can be mapped into memory and used without parsing. Event
+   * properties are not stored.
+   */
+  struct SILENCE_PUBLIC BinaryScoreHeader
+  {
+    enum
+      {
+        FORMAT_VERSION = 1,
+        BYTE_ORDER_MARK = 0x01020304,
+        HAS_TIME_INDEX = 1,
+        ALIGNMENT = 64
+      };
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t dimensions;
+    uint32_t flags;
+    uint64_t eventCount;
+    uint64_t reserved[4];
+    static const char *MAGIC()
+    {
+      return "CSACSCR1";
+    }
+    void initialize(uint64_t eventCount_, uint32_t flags_)
+    {
+      std::memset(this, 0, sizeof(*this));
+      std::memcpy(magic, MAGIC(), sizeof(magic));
+      version = FORMAT_VERSION;
+      byteOrderMark = BYTE_ORDER_MARK;
+      dimensions = Event::ELEMENT_COUNT;
+      flags = flags_;
+      eventCount = eventCount_;
+    }
+    bool isValid() const
+    {
+      return std::memcmp(magic, MAGIC(), sizeof(magic)) == 0 &&
+        version == FORMAT_VERSION &&
+        byteOrderMark == BYTE_ORDER_MARK &&
+        dimensions == Event::ELEMENT_COUNT;
+    }
+    static uint64_t align(uint64_t offset)
+    {
+      return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+    uint64_t columnOffset(int dimension) const
+    {
+      return align(sizeof(BinaryScoreHeader)) + uint64_t(dimension) * align(eventCount * sizeof(double));
+    }
+    uint64_t timeIndexOffset() const
+    {
+      return columnOffset(Event::ELEMENT_COUNT);
+    }
+    uint64_t fileSize() const
+    {
+      uint64_t size = timeIndexOffset();
+      if (flags & HAS_TIME_INDEX) {
+        size += eventCount * sizeof(uint64_t);
+      }
+      return size;
+    }
+    /**
+     * Returns true if a file of fileSize_ bytes holds all the data that
+     * this header describes. eventCount is first checked against the
+     * largest count the file could hold, so that a corrupt count cannot
+     * overflow the offsets computed by fileSize().
+     */
+    bool fitsIn(uint64_t fileSize_) const
+    {
+      uint64_t headerSize = align(sizeof(BinaryScoreHeader));
+      if (fileSize_ < headerSize) {
+        return false;
+      }
+      uint64_t bytesPerEvent = sizeof(double) * Event::ELEMENT_COUNT;
+      if (flags & HAS_TIME_INDEX) {
+        bytesPerEvent += sizeof(uint64_t);
+      }
+      if (eventCount > (fileSize_ - headerSize) / bytesPerEvent) {
+        return false;
+      }
+      return fileSize_ >= fileSize();
+    }
+  };
+
+  struct SILENCE_PUBLIC BinaryScoreTimeLess
+  {
+    const Score *score;
+    BinaryScoreTimeLess(const Score *score_) : score(score_)
+    {
+    }
+    bool operator()(uint64_t a, uint64_t b) const
+    {
+      return (*score)[size_t(a)].getTime() < (*score)[size_t(b)].getTime();
+    }
+  };
+
+  /**
+   * Saves the score in the binary score format, with a time index if
+   * timeIndex is true. Returns false on error.
+   */
+  inline SILENCE_PUBLIC bool saveBinaryScore(const Score &score, std::string filename, bool timeIndex = true)
+  {
+    FILE *file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+      return false;
+    }
+    BinaryScoreHeader header;
+    header.initialize(score.size(), timeIndex ? uint32_t(BinaryScoreHeader::HAS_TIME_INDEX) : 0);
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    std::vector<char> padding(BinaryScoreHeader::ALIGNMENT, 0);
+    uint64_t position = sizeof(header);
+    std::vector<double> column(score.size());
+    for (int dimension = 0; ok && dimension < Event::ELEMENT_COUNT; ++dimension) {
+      uint64_t offset = header.columnOffset(dimension);
+      ok = std::fwrite(&padding[0], 1, size_t(offset - position), file) == size_t(offset - position);
+      for (size_t i = 0, n = score.size(); i < n; ++i) {
+        column[i] = dimension < score[i].size() ? score[i][dimension] : 0.0;
+      }
+      if (ok && !column.empty()) {
+        ok = std::fwrite(&column[0], sizeof(double), column.size(), file) == column.size();
+      }
+      position = offset + column.size() * sizeof(double);
+    }
+    if (ok && timeIndex) {
+      uint64_t offset = header.timeIndexOffset();
+      ok = std::fwrite(&padding[0], 1, size_t(offset - position), file) == size_t(offset - position);
+      std::vector<uint64_t> indexes(score.size());
+      for (size_t i = 0, n = score.size(); i < n; ++i) {
+        indexes[i] = i;
+      }
+      std::stable_sort(indexes.begin(), indexes.end(), BinaryScoreTimeLess(&score));
+      if (ok && !indexes.empty()) {
+        ok = std::fwrite(&indexes[0], sizeof(uint64_t), indexes.size(), file) == indexes.size();
+      }
+    }
+    if (std::fclose(file) != 0) {
+      ok = false;
+    }
+    return ok;
+  }
+
+  /**
+   * A read-only view of a binary score file mapped into memory. Opening
+   * the file reads only the header; each dimension is then available as
+   * an array of doubles directly in the mapping, and events are built on
+   * demand.
+   */
+  class SILENCE_PUBLIC MappedScore
+  {
+  protected:
+    MappedFile file;
+    const char *data;
+    const BinaryScoreHeader *header;
+  public:
+    MappedScore() : data(0), header(0)
+    {
+    }
+    MappedScore(std::string filename) : data(0), header(0)
+    {
+      open(filename);
+    }
+    virtual ~MappedScore()
+    {
+      close();
+    }
+    /**
+     * Maps the file and checks its header; returns false if the file
+     * cannot be mapped or is not a valid binary score.
+     */
+    bool open(std::string filename)
+    {
+      close();
+      if (!file.open(filename)) {
+        return false;
+      }
+      data = file.data();
+      header = (const BinaryScoreHeader *) data;
+      if (file.size() < sizeof(BinaryScoreHeader) || !header->isValid() || !header->fitsIn(file.size())) {
+        close();
+        return false;
+      }
+      return true;
+    }
+    void close()
+    {
+      file.close();
+      data = 0;
+      header = 0;
+    }
+    bool isOpen() const
+    {
+      return header != 0;
+    }
+    size_t size() const
+    {
+      return header ? size_t(header->eventCount) : 0;
+    }
+    /**
+     * Returns the values of one dimension for all events.
+     */
+    const double *column(int dimension) const
+    {
+      return (const double *) (data + header->columnOffset(dimension));
+    }
+    /**
+     * Returns the indexes of the events in order of start time, or 0 if
+     * the file has no time index.
+     */
+    const uint64_t *timeIndex() const
+    {
+      if (!(header->flags & BinaryScoreHeader::HAS_TIME_INDEX)) {
+        return 0;
+      }
+      return (const uint64_t *) (data + header->timeIndexOffset());
+    }
+    double value(size_t index, int dimension) const
+    {
+      return column(dimension)[index];
+    }
+    Event getEvent(size_t index) const
+    {
+      Event event;
+      event.resize(Event::ELEMENT_COUNT);
+      for (int dimension = 0; dimension < Event::ELEMENT_COUNT; ++dimension) {
+        event[dimension] = column(dimension)[index];
+      }
+      return event;
+    }
+    /**
+     * Appends all events to the score.
+     */
+    void toScore(Score &score) const
+    {
+      size_t n = size();
+      score.reserve(score.size() + n);
+      for (size_t i = 0; i < n; ++i) {
+        score.push_back(getEvent(i));
+      }
+    }
+  private:
+    MappedScore(const MappedScore &);
+    MappedScore &operator = (const MappedScore &);
+  };
+
+  /**
+   * Appends the events of a binary score file to the score; returns false
+   * if the file cannot be read.
+   */
+  inline SILENCE_PUBLIC bool loadBinaryScore(std::string filename, Score &score)
+  {
+    MappedScore mapped;
+    if (!mapped.open(filename)) {
+      return false;
+    }
+    mapped.toScore(score);
+    return true;
+  }
+
+  /**
+   * Reads Csound score text, such as that written by CsoundScoreWriter,
+   * in chunks of bounded size, and passes each "i" statement as an Event
+   * to a callback as soon as it is read, so that score files larger than
+   * memory can be filtered, rescaled, or re-timed in one pass.
+   * <p>
+   * Only a subset of the Csound score language is accepted: the subset
+   * that CsoundScoreWriter writes, plus sections. That is:
+   * <ul>
+   * <li>"i" statements with numeric p-fields, taken in the order written
+   * by CsoundScoreWriter: instrument, time, duration, key, velocity, depth,
+   * pan, height, phase, and pitch-class set. P-fields after the tenth are
+   * ignored.</li>
+   * <li>As in Csound, "." (the same value), "+" in p2 (the end of the
+   * previous note), and omitted trailing p-fields carry from the
+   * immediately preceding "i" statement, but only if it has the same p1.
+   * Otherwise omitted p-fields are 0, except for the pitch-class set,
+   * which is 4095, and "." or "+" is an error.</li>
+   * <li>"f" statements, which are skipped.</li>
+   * <li>"s" statements, after which times are offset by the end of the
+   * section, or by the time in the "s" statement's p1 if that is later,
+   * and nothing is carried.</li>
+   * <li>"e", which stops reading.</li>
+   * </ul>
+   * Any other statement, such as "t", "b", "a", or "v", which would change
+   * the times of the notes, and any other p-field syntax, such as
+   * expressions, ramps, or named instruments, stops reading with an error;
+   * see getError(). Numbers are read in the "C" locale whatever the
+   * current locale is. Comments are skipped.
+   */
+  class SILENCE_PUBLIC CsoundScoreReader
+  {
+  public:
+    /**
+     * Number of bytes read from the stream at a time.
+     */
+    size_t chunkSize;
+    CsoundScoreReader(size_t chunkSize_ = 1 << 20) : chunkSize(chunkSize_), inBlockComment(false), ended(false), hasPrevious(false), sectionOffset(0.0), sectionEnd(0.0), lineNumber(0)
+    {
+    }
+    virtual ~CsoundScoreReader()
+    {
+    }
+    /**
+     * Reads the stream to its end, or to an "e" statement, calling
+     * callback(const Event &) for each note; stops early and returns false
+     * if the callback returns false, or if the score cannot be read, in
+     * which case getError() describes why.
+     */
+    template<typename Callback>
+    bool read(std::istream &stream, Callback callback)
+    {
+      reset();
+      std::vector<char> buffer(std::max<size_t>(chunkSize, 1));
+      size_t used = 0;
+      Event event;
+      for (;;) {
+        if (used == buffer.size()) {
+          // A line longer than the buffer.
+          buffer.resize(buffer.size() * 2);
+        }
+        stream.read(&buffer[used], std::streamsize(buffer.size() - used));
+        size_t count = size_t(stream.gcount());
+        bool end = count == 0;
+        used += count;
+        size_t begin = 0;
+        for (size_t i = 0; i < used; ++i) {
+          if (buffer[i] == '\n') {
+            buffer[i] = '\0';
+            if (parseLine(&buffer[begin], event) && !callback(event)) {
+              return false;
+            }
+            if (!error.empty()) {
+              return false;
+            }
+            if (ended) {
+              return true;
+            }
+            begin = i + 1;
+          }
+        }
+        if (end) {
+          if (begin < used) {
+            buffer.resize(used + 1);
+            buffer[used] = '\0';
+            if (parseLine(&buffer[begin], event) && !callback(event)) {
+              return false;
+            }
+          }
+          return error.empty();
+        }
+        std::memmove(&buffer[0], &buffer[begin], used - begin);
+        used -= begin;
+      }
+    }
+    /**
+     * Reads the stream as above, collecting notes into the partial score
+     * and calling callback(Score &) whenever it holds maximumEvents notes,
+     * and once more for any remaining notes; the partial score is cleared
+     * after each call. Returns false if the callback returns false, or if
+     * the score cannot be read.
+     */
+    template<typename Callback>
+    bool read(std::istream &stream, Score &partial, size_t maximumEvents, Callback callback)
+    {
+      partial.clear();
+      partial.reserve(maximumEvents);
+      bool ok = read(stream, [&partial, maximumEvents, &callback](const Event &event) {
+        partial.push_back(event);
+        if (partial.size() >= maximumEvents) {
+          bool result = callback(partial);
+          partial.clear();
+          return result;
+        }
+        return true;
+      });
+      if (ok && !partial.empty()) {
+        ok = callback(partial);
+        partial.clear();
+      }
+      return ok;
+    }
+    /**
+     * Returns why the last read stopped before the end of the score, with
+     * its line number, or an empty string if it did not stop on an error.
+     */
+    const std::string &getError() const
+    {
+      return error;
+    }
+  protected:
+    enum
+      {
+        PFIELDS = 10
+      };
+    double previous[PFIELDS];
+    bool inBlockComment;
+    bool ended;
+    bool hasPrevious;
+    double sectionOffset;
+    double sectionEnd;
+    size_t lineNumber;
+    std::string error;
+    void reset()
+    {
+      for (int i = 0; i < PFIELDS; ++i) {
+        previous[i] = 0.0;
+      }
+      previous[PFIELDS - 1] = 4095.0;
+      inBlockComment = false;
+      ended = false;
+      hasPrevious = false;
+      sectionOffset = 0.0;
+      sectionEnd = 0.0;
+      lineNumber = 0;
+      error.clear();
+    }
+    void setError(const char *message, const char *token = 0)
+    {
+      char buffer[64];
+      std::snprintf(buffer, sizeof(buffer), "line %lu: ", (unsigned long) lineNumber);
+      error = buffer;
+      error += message;
+      if (token) {
+        error += ": ";
+        error += std::string(token, std::strcspn(token, " \t\r"));
+      }
+    }
+    static bool isSpace(char c)
+    {
+      return c == ' ' || c == '\t' || c == '\r';
+    }
+    static const char *skipSpaces(const char *p)
+    {
+      while (isSpace(*p)) {
+        ++p;
+      }
+      return p;
+    }
+    static const char *tokenEnd(const char *p)
+    {
+      while (*p && !isSpace(*p)) {
+        ++p;
+      }
+      return p;
+    }
+    /**
+     * Removes comments from the line in place.
+     */
+    void stripComments(char *line)
+    {
+      char *out = line;
+      for (char *p = line; *p; ++p) {
+        if (inBlockComment) {
+          if (p[0] == '*' && p[1] == '/') {
+            inBlockComment = false;
+            ++p;
+          }
+          continue;
+        }
+        if (p[0] == ';' || (p[0] == '/' && p[1] == '/')) {
+          break;
+        }
+        if (p[0] == '/' && p[1] == '*') {
+          inBlockComment = true;
+          ++p;
+          continue;
+        }
+        *out++ = *p;
+      }
+      *out = '\0';
+    }
+    /**
+     * Parses one line; returns true and sets the event if it is an "i"
+     * statement, and sets the error if it cannot be read.
+     */
+    bool parseLine(char *line, Event &event)
+    {
+      ++lineNumber;
+      stripComments(line);
+      const char *p = skipSpaces(line);
+      switch (*p) {
+      case '\0':
+        return false;
+      case 'e':
+        ended = true;
+        return false;
+      case 'f':
+        return false;
+      case 's':
+        return parseSection(p + 1);
+      case 'i':
+        return parseNote(p + 1, event);
+      default:
+        setError("unsupported statement", p);
+        return false;
+      }
+    }
+    bool parseSection(const char *p)
+    {
+      p = skipSpaces(p);
+      double end = sectionEnd;
+      if (*p) {
+        double time = 0.0;
+        const char *end_ = tokenEnd(p);
+        if (!parseScoreNumber(p, end_, time)) {
+          setError("unsupported p-field", p);
+          return false;
+        }
+        end = std::max(end, sectionOffset + time);
+      }
+      sectionOffset = end;
+      sectionEnd = end;
+      hasPrevious = false;
+      return false;
+    }
+    bool parseNote(const char *p, Event &event)
+    {
+      double pfields[PFIELDS];
+      bool sameInstrument = false;
+      int count = 0;
+      for (; count < PFIELDS; ++count) {
+        p = skipSpaces(p);
+        if (*p == '\0') {
+          break;
+        }
+        const char *end = tokenEnd(p);
+        bool carry = end == p + 1 && *p == '.';
+        bool follow = end == p + 1 && *p == '+' && count == 1;
+        if (carry || follow) {
+          if (!sameInstrument) {
+            setError("nothing to carry from", p);
+            return false;
+          }
+          pfields[count] = carry ? previous[count] : previous[1] + previous[2];
+        } else if (!parseScoreNumber(p, end, pfields[count])) {
+          setError("unsupported p-field", p);
+          return false;
+        }
+        if (count == 0) {
+          sameInstrument = hasPrevious && pfields[0] == previous[0];
+        }
+        p = end;
+      }
+      if (count == 0) {
+        setError("missing instrument number");
+        return false;
+      }
+      for (int i = count; i < PFIELDS; ++i) {
+        if (sameInstrument) {
+          pfields[i] = previous[i];
+        } else {
+          pfields[i] = i == PFIELDS - 1 ? 4095.0 : 0.0;
+        }
+      }
+      for (int i = 0; i < PFIELDS; ++i) {
+        previous[i] = pfields[i];
+      }
+      hasPrevious = true;
+      double time = sectionOffset + pfields[1];
+      sectionEnd = std::max(sectionEnd, time + std::max(pfields[2], 0.0));
+      event.set(time, pfields[2], 144.0, pfields[0], pfields[3], pfields[4], pfields[8], pfields[6], pfields[5], pfields[7], pfields[9]);
+      return true;
+    }
+  };
+}
+#endif
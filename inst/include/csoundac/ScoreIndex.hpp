@@ -0,0 +1,527 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SCOREINDEX_H
+#define SCOREINDEX_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include "Score.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <set>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+%}
+%include "std_vector.i"
+#else
+#include "Score.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <set>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace csound
+{
+  /**
+   * Base class for indexes built from a Score. An index is built on
+   * demand, and is rebuilt automatically when the score it was built for
+   * is a different object, has been resized or reallocated, or has
+   * different first or last start times. Code that changes times or
+   * durations in place without any of those effects must call
+   * invalidate().
+   */
+  class SILENCE_PUBLIC ScoreIndexBase
+  {
+  protected:
+    const Score *score;
+    size_t size;
+    const Event *data;
+    double frontTime;
+    double backTime;
+    bool valid;
+    bool isCurrent(const Score &score_) const
+    {
+      if (!valid || score != &score_ || size != score_.size()) {
+        return false;
+      }
+      if (size == 0) {
+        return true;
+      }
+      return data == &score_[0] &&
+        frontTime == score_.front().getTime() &&
+        backTime == score_.back().getTime();
+    }
+    void setCurrent(const Score &score_)
+    {
+      score = &score_;
+      size = score_.size();
+      data = size ? &score_[0] : 0;
+      frontTime = size ? score_.front().getTime() : 0;
+      backTime = size ? score_.back().getTime() : 0;
+      valid = true;
+    }
+    virtual void build(const Score &score_) = 0;
+  public:
+    ScoreIndexBase() : score(0), size(0), data(0), frontTime(0), backTime(0), valid(false)
+    {
+    }
+    virtual ~ScoreIndexBase()
+    {
+    }
+    /**
+     * Forces the index to be rebuilt before the next query.
+     */
+    void invalidate()
+    {
+      valid = false;
+    }
+    /**
+     * Rebuilds the index if it is not current for the score.
+     */
+    void update(const Score &score_)
+    {
+      if (isCurrent(score_)) {
+        return;
+      }
+      build(score_);
+      setCurrent(score_);
+    }
+  };
+
+  /**
+   * An index of the events of a Score by start time, which answers time
+   * range queries in O(log n) instead of scanning the whole score.
+   * <p>
+   * The index holds the start times of the events in ascending order,
+   * the index of each event in the score, and the running maximum of the
+   * off times in that order, which bounds how far back an overlap query
+   * must look.
+   */
+  class SILENCE_PUBLIC ScoreTimeIndex :
+    public ScoreIndexBase
+  {
+  protected:
+    std::vector<double> startTimes;
+    std::vector<size_t> indexes;
+    std::vector<double> maximumOffTimes;
+    struct StartTimeLess
+    {
+      const Score *score;
+      StartTimeLess(const Score *score_) : score(score_)
+      {
+      }
+      bool operator()(size_t a, size_t b) const
+      {
+        return (*score)[a].getTime() < (*score)[b].getTime();
+      }
+    };
+    virtual void build(const Score &score_)
+    {
+      size_t n = score_.size();
+      indexes.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        indexes[i] = i;
+      }
+      std::stable_sort(indexes.begin(), indexes.end(), StartTimeLess(&score_));
+      startTimes.resize(n);
+      maximumOffTimes.resize(n);
+      double maximumOffTime = -DBL_MAX;
+      for (size_t i = 0; i < n; ++i) {
+        const Event &event = score_[indexes[i]];
+        startTimes[i] = event.getTime();
+        maximumOffTime = std::max(maximumOffTime, event.getOffTime());
+        maximumOffTimes[i] = maximumOffTime;
+      }
+    }
+  public:
+    ScoreTimeIndex()
+    {
+    }
+    ScoreTimeIndex(const Score &score_)
+    {
+      update(score_);
+    }
+    virtual ~ScoreTimeIndex()
+    {
+    }
+    /**
+     * Returns the position, in start time order, of the first event at
+     * or after the time. For a score sorted by time this is the same as
+     * Score::indexAtTime.
+     */
+    size_t indexAtTime(const Score &score_, double time)
+    {
+      update(score_);
+      return std::lower_bound(startTimes.begin(), startTimes.end(), time) - startTimes.begin();
+    }
+    /**
+     * Returns the position, in start time order, of the first event after
+     * the time. For a score sorted by time this is the same as
+     * Score::indexAfterTime.
+     */
+    size_t indexAfterTime(const Score &score_, double time)
+    {
+      update(score_);
+      return std::upper_bound(startTimes.begin(), startTimes.end(), time) - startTimes.begin();
+    }
+    /**
+     * Returns the index in the score of the event at a position in start
+     * time order.
+     */
+    size_t scoreIndex(size_t position) const
+    {
+      return indexes[position];
+    }
+    /**
+     * Returns the indexes in the score of all events that start at or after
+     * the start time and before the end time, in score order.
+     */
+    std::vector<size_t> starting(const Score &score_, double startTime, double endTime)
+    {
+      update(score_);
+      std::vector<size_t> result;
+      if (!(startTime < endTime)) {
+        return result;
+      }
+      size_t begin = std::lower_bound(startTimes.begin(), startTimes.end(), startTime) - startTimes.begin();
+      size_t end = std::lower_bound(startTimes.begin(), startTimes.end(), endTime) - startTimes.begin();
+      result.assign(indexes.begin() + begin, indexes.begin() + end);
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+    /**
+     * Returns the indexes in the score of all events that sound at some
+     * time in [startTime, endTime), in score order. Only events whose
+     * start precedes the end time, and whose running maximum off time
+     * follows the start time, are examined.
+     */
+    std::vector<size_t> overlapping(const Score &score_, double startTime, double endTime)
+    {
+      update(score_);
+      std::vector<size_t> result;
+      size_t end = std::lower_bound(startTimes.begin(), startTimes.end(), endTime) - startTimes.begin();
+      for (size_t i = end; i > 0 && maximumOffTimes[i - 1] > startTime; --i) {
+        const Event &event = score_[indexes[i - 1]];
+        if (event.getOffTime() > startTime) {
+          result.push_back(indexes[i - 1]);
+        }
+      }
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+  };
+
+  /**
+   * A centered interval tree over the intervals [time, offTime] of the
+   * events of a Score, which finds all events sounding at a time, or
+   * overlapping a time range, in O(log n + k) for k results, where a scan
+   * of the score would take O(n).
+   * <p>
+   * Each node holds a center time and the events whose intervals contain
+   * it, both in order of start time and in descending order of off time;
+   * events entirely before or after the center are in the left or right
+   * subtree. The index is rebuilt as described for ScoreIndexBase.
+   */
+  class SILENCE_PUBLIC ScoreIntervalTree :
+    public ScoreIndexBase
+  {
+  protected:
+    struct Interval
+    {
+      double start;
+      double end;
+      size_t index;
+    };
+    struct StartLess
+    {
+      bool operator()(const Interval &a, const Interval &b) const
+      {
+        return a.start < b.start;
+      }
+    };
+    struct EndGreater
+    {
+      bool operator()(const Interval &a, const Interval &b) const
+      {
+        return a.end > b.end;
+      }
+    };
+    struct Node
+    {
+      double center;
+      std::vector<Interval> byStart;
+      std::vector<Interval> byEnd;
+      int left;
+      int right;
+    };
+    std::vector<Node> nodes;
+    int root;
+    int buildNode(std::vector<Interval> &intervals)
+    {
+      if (intervals.empty()) {
+        return -1;
+      }
+      std::vector<double> endpoints;
+      endpoints.reserve(intervals.size() * 2);
+      for (size_t i = 0, n = intervals.size(); i < n; ++i) {
+        endpoints.push_back(intervals[i].start);
+        endpoints.push_back(intervals[i].end);
+      }
+      std::nth_element(endpoints.begin(), endpoints.begin() + endpoints.size() / 2, endpoints.end());
+      double center = endpoints[endpoints.size() / 2];
+      std::vector<Interval> left;
+      std::vector<Interval> right;
+      Node node;
+      node.center = center;
+      for (size_t i = 0, n = intervals.size(); i < n; ++i) {
+        if (intervals[i].end < center) {
+          left.push_back(intervals[i]);
+        } else if (intervals[i].start > center) {
+          right.push_back(intervals[i]);
+        } else {
+          node.byStart.push_back(intervals[i]);
+        }
+      }
+      std::vector<Interval>().swap(intervals);
+      node.byEnd = node.byStart;
+      std::sort(node.byStart.begin(), node.byStart.end(), StartLess());
+      std::sort(node.byEnd.begin(), node.byEnd.end(), EndGreater());
+      int index = (int) nodes.size();
+      nodes.push_back(node);
+      int leftChild = buildNode(left);
+      int rightChild = buildNode(right);
+      nodes[index].left = leftChild;
+      nodes[index].right = rightChild;
+      return index;
+    }
+    virtual void build(const Score &score_)
+    {
+      nodes.clear();
+      std::vector<Interval> intervals(score_.size());
+      for (size_t i = 0, n = score_.size(); i < n; ++i) {
+        intervals[i].start = score_[i].getTime();
+        intervals[i].end = std::max(intervals[i].start, score_[i].getOffTime());
+        intervals[i].index = i;
+      }
+      root = buildNode(intervals);
+    }
+    /**
+     * Appends the indexes of the events with start <= time, and with
+     * time < end, or time <= end if inclusiveEnd is true.
+     */
+    void at(int node_, double time, bool inclusiveEnd, std::vector<size_t> &result) const
+    {
+      while (node_ != -1) {
+        const Node &node = nodes[node_];
+        if (time < node.center) {
+          for (size_t i = 0, n = node.byStart.size(); i < n && node.byStart[i].start <= time; ++i) {
+            result.push_back(node.byStart[i].index);
+          }
+          node_ = node.left;
+        } else if (time > node.center) {
+          for (size_t i = 0, n = node.byEnd.size(); i < n && (node.byEnd[i].end > time || (inclusiveEnd && node.byEnd[i].end == time)); ++i) {
+            result.push_back(node.byEnd[i].index);
+          }
+          node_ = node.right;
+        } else {
+          for (size_t i = 0, n = node.byEnd.size(); i < n && (node.byEnd[i].end > time || inclusiveEnd); ++i) {
+            result.push_back(node.byEnd[i].index);
+          }
+          node_ = -1;
+        }
+      }
+    }
+    /**
+     * Appends the indexes of the events with start < endTime and
+     * end > startTime.
+     */
+    void overlapping(int node_, double startTime, double endTime, std::vector<size_t> &result) const
+    {
+      while (node_ != -1) {
+        const Node &node = nodes[node_];
+        if (endTime <= node.center) {
+          for (size_t i = 0, n = node.byStart.size(); i < n && node.byStart[i].start < endTime; ++i) {
+            result.push_back(node.byStart[i].index);
+          }
+          node_ = node.left;
+        } else if (startTime >= node.center) {
+          for (size_t i = 0, n = node.byEnd.size(); i < n && node.byEnd[i].end > startTime; ++i) {
+            result.push_back(node.byEnd[i].index);
+          }
+          node_ = node.right;
+        } else {
+          for (size_t i = 0, n = node.byStart.size(); i < n; ++i) {
+            result.push_back(node.byStart[i].index);
+          }
+          overlapping(node.left, startTime, endTime, result);
+          node_ = node.right;
+        }
+      }
+    }
+  public:
+    ScoreIntervalTree() : root(-1)
+    {
+    }
+    ScoreIntervalTree(const Score &score_) : root(-1)
+    {
+      update(score_);
+    }
+    virtual ~ScoreIntervalTree()
+    {
+    }
+    /**
+     * Returns the indexes in the score, in score order, of all events
+     * sounding at the time, that is, with time <= t < offTime.
+     */
+    std::vector<size_t> sounding(const Score &score_, double time)
+    {
+      update(score_);
+      std::vector<size_t> result;
+      at(root, time, false, result);
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+    /**
+     * Returns the indexes in the score, in score order, of all events
+     * sounding at or ending exactly at the time, that is, with
+     * time <= t <= offTime.
+     */
+    std::vector<size_t> touching(const Score &score_, double time)
+    {
+      update(score_);
+      std::vector<size_t> result;
+      at(root, time, true, result);
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+    /**
+     * Returns the indexes in the score, in score order, of all events
+     * that sound at some time in [startTime, endTime).
+     */
+    std::vector<size_t> overlapping(const Score &score_, double startTime, double endTime)
+    {
+      update(score_);
+      std::vector<size_t> result;
+      if (startTime < endTime) {
+        overlapping(root, startTime, endTime, result);
+      }
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+  };
+
+  /**
+   * Returns the voicing of the notes sounding at some time in the time
+   * window [startTime, endTime), including notes that begin before the
+   * window and are still held in it: their unique pitches from lowest to
+   * highest, omitting any pitch whose pitch-class is already present.
+   * Score::getVoicing, by contrast, takes a range of event indexes, and
+   * considers only the events in that range.
+   */
+  inline SILENCE_PUBLIC std::vector<double> getVoicingAt(const Score &score, ScoreIntervalTree &tree, double startTime, double endTime, size_t divisionsPerOctave = 12)
+  {
+    std::vector<size_t> indexes = tree.overlapping(score, startTime, endTime);
+    std::set<double> pitches;
+    for (size_t i = 0, n = indexes.size(); i < n; ++i) {
+      const Event &event = score[indexes[i]];
+      if (event.isNoteOn()) {
+        pitches.insert(event.getKey());
+      }
+    }
+    std::vector<double> voicing;
+    std::set<double> pitchClasses;
+    for (std::set<double>::iterator it = pitches.begin(); it != pitches.end(); ++it) {
+      double pitchClass = std::fmod(*it, double(divisionsPerOctave));
+      if (pitchClass < 0.0) {
+        pitchClass += double(divisionsPerOctave);
+      }
+      if (pitchClasses.insert(pitchClass).second) {
+        voicing.push_back(*it);
+      }
+    }
+    return voicing;
+  }
+
+  /**
+   * If the score contains two note on events of the same pitch and loudness
+   * greater than 0 that overlap or touch in time, extends the earlier note to the
+   * later off time and removes the later note, as
+   * Score::tieOverlappingNotes does, but in O(n log n): the score is sorted,
+   * and one sweep in time order keeps a hash map from each pitch, and
+   * instrument if considerInstrumentNumber is true, to the note of that
+   * pitch that is still open, into which any overlapping note is merged.
+   * Chains of overlapping notes become one note.
+   */
+  inline SILENCE_PUBLIC void tieOverlappingNotes(Score &score, bool considerInstrumentNumber = false)
+  {
+    score.sort();
+    size_t n = score.size();
+    std::vector<bool> tied(n, false);
+    std::vector<bool> extended(n, false);
+    std::vector<double> offTimes(n);
+    std::unordered_map<uint64_t, size_t> openNotes;
+    openNotes.reserve(256);
+    for (size_t i = 0; i < n; ++i) {
+      const Event &event = score[i];
+      offTimes[i] = event.getOffTime();
+      if (!event.isNoteOn() || event.getVelocity() <= 0.0) {
+        continue;
+      }
+      uint64_t voice = uint64_t(uint32_t(event.getKeyNumber()));
+      if (considerInstrumentNumber) {
+        voice |= uint64_t(uint32_t(event.getChannel())) << 32;
+      }
+      std::unordered_map<uint64_t, size_t>::iterator it = openNotes.find(voice);
+      if (it != openNotes.end() && offTimes[it->second] >= event.getTime()) {
+        if (offTimes[i] > offTimes[it->second]) {
+          offTimes[it->second] = offTimes[i];
+          extended[it->second] = true;
+        }
+        tied[i] = true;
+      } else {
+        openNotes[voice] = i;
+      }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (tied[i]) {
+        continue;
+      }
+      if (kept != i) {
+        score[kept] = score[i];
+      }
+      // Only extended notes are rewritten, because setting the off time
+      // recomputes the duration, which can change its last bits.
+      if (extended[i]) {
+        score[kept].setOffTime(offTimes[i]);
+      }
+      ++kept;
+    }
+    score.resize(kept);
+  }
+}
+#endif
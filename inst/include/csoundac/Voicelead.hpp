@@ -26,6 +26,7 @@
 %{
 #include "Event.hpp"
 #include "CppSound.hpp"
+#include "PitchClassMask.hpp"
 #include <vector>
 #include <algorithm>
 #include <cmath>
@@ -34,6 +35,7 @@
 %template(ChordVector) std::vector< std::vector<double> >;
 #else
 #include "Event.hpp"
+#include "PitchClassMask.hpp"
 #include <vector>
 #endif
 
@@ -154,6 +156,32 @@ namespace csound
      */
     static std::vector<double> mToPitchClassSet(double pcn, size_t divisionsPerOctave = 12);
 
+    /**
+     * Same as pitchClassSetToM, but when there are 12 divisions per octave
+     * and every pitch is a whole number of semitones, the number is computed
+     * as a bit mask, without floating-point arithmetic.
+     */
+    static double pitchClassSetToMFast(const std::vector<double> &chord, size_t divisionsPerOctave = 12)
+    {
+      uint16_t mask;
+      if (divisionsPerOctave == PitchClassMasks::DIVISIONS && pitchClassMask(chord, mask)) {
+        return double(mask);
+      }
+      return pitchClassSetToM(chord, divisionsPerOctave);
+    }
+
+    /**
+     * Same as mToPitchClassSet, but when there are 12 divisions per octave
+     * and M is a 12-bit mask, the set is read from its bits.
+     */
+    static std::vector<double> mToPitchClassSetFast(double pcn, size_t divisionsPerOctave = 12)
+    {
+      if (divisionsPerOctave == PitchClassMasks::DIVISIONS && pcn >= 0.0 && pcn <= double(PitchClassMasks::ALL) && pcn == std::floor(pcn)) {
+        return maskToPitchClasses(uint16_t(pcn));
+      }
+      return mToPitchClassSet(pcn, divisionsPerOctave);
+    }
+
     /**
      * Convert a pitch-class set to a prime chord number and a transposition.
      * Note that the prime chord numbers, and transpositions, each form an additive cyclic group.
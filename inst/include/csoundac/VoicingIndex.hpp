@@ -0,0 +1,357 @@
+/*
+ * C S O U N D
+ *
+ * L I C E N S E
+ *
+ * This software is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef VOICINGINDEX_H
+#define VOICINGINDEX_H
+#include "Platform.hpp"
+#ifdef SWIG
+%module CsoundAC
+%{
+#include "ChordSpace.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+%}
+%include "std_vector.i"
+#else
+#include "ChordSpace.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#endif
+
+namespace csound
+{
+  /**
+   * A vantage-point tree over a set of voicings of a destination chord, by
+   * default its octavewise revoicings within a range, which finds the
+   * voicing with the closest voice-leading from a source chord in about
+   * logarithmic time rather than by visiting every voicing.
+   * <p>
+   * Voice-leadings are compared first by smoothness (L1 norm, as in
+   * voiceleadingSmoothness), then by simplicity (more common tones, as in
+   * voiceleadingSimpler), then by the order of the voicings. Voicings that
+   * form a parallel fifth with the source (as in parallelFifth) may be
+   * excluded; if every voicing does, the filter is ignored.
+   */
+  class SILENCE_PUBLIC VoicingIndex
+  {
+  public:
+    VoicingIndex() : voiceN(0), root(-1)
+    {
+    }
+    VoicingIndex(const Chord &destination, double range) : voiceN(0), root(-1)
+    {
+      build(destination, range);
+    }
+    virtual ~VoicingIndex()
+    {
+    }
+    /**
+     * Indexes the octavewise revoicings of the destination within the
+     * range, in the order of octavewiseRevoicing: its OP form, then each
+     * voicing produced by next() with a step of one octave.
+     */
+    virtual void build(const Chord &destination, double range)
+    {
+      std::vector<Chord> revoicings;
+      Chord origin = csound::normalize<EQUIVALENCE_RELATION_RP>(destination, OCTAVE(), 1.0);
+      Chord revoicing = origin;
+      revoicings.push_back(revoicing);
+      while (next(revoicing, origin, range, OCTAVE())) {
+        revoicings.push_back(revoicing);
+      }
+      build(revoicings);
+    }
+    /**
+     * Indexes any voicings, which must all have the same number of voices.
+     */
+    virtual void build(const std::vector<Chord> &voicings_)
+    {
+      voicings = voicings_;
+      nodes.clear();
+      root = -1;
+      voiceN = voicings.empty() ? 0 : int(voicings.front().voices());
+      pitches.resize(voicings.size() * voiceN);
+      for (size_t i = 0, n = voicings.size(); i < n; ++i) {
+        for (int voice = 0; voice < voiceN; ++voice) {
+          pitches[i * voiceN + voice] = voicings[i].getPitch(voice);
+        }
+      }
+      std::vector<int> points(voicings.size());
+      for (size_t i = 0; i < points.size(); ++i) {
+        points[i] = int(i);
+      }
+      nodes.reserve(points.size());
+      root = buildNode(points, 0, points.size());
+    }
+    size_t size() const
+    {
+      return voicings.size();
+    }
+    const Chord &voicing(size_t index) const
+    {
+      return voicings[index];
+    }
+    /**
+     * Returns the index of the voicing with the closest voice-leading from
+     * the source, optionally avoiding parallel fifths, or -1 if the index
+     * is empty or the source has a different number of voices.
+     */
+    int closestIndex(const Chord &source, bool avoidParallels = false) const
+    {
+      if (root == -1 || int(source.voices()) != voiceN) {
+        return -1;
+      }
+      std::vector<double> query(voiceN);
+      for (int voice = 0; voice < voiceN; ++voice) {
+        query[voice] = source.getPitch(voice);
+      }
+      Candidate best;
+      search(root, &query[0], avoidParallels, best);
+      if (best.point == -1 && avoidParallels) {
+        search(root, &query[0], false, best);
+      }
+      return best.point;
+    }
+    /**
+     * Returns the voicing with the closest voice-leading from the source,
+     * optionally avoiding parallel fifths, or the source itself if there
+     * is none.
+     */
+    Chord closest(const Chord &source, bool avoidParallels = false) const
+    {
+      int index = closestIndex(source, avoidParallels);
+      if (index == -1) {
+        return source;
+      }
+      return voicings[index];
+    }
+  protected:
+    struct Node
+    {
+      int point;
+      double threshold;
+      int inside;
+      int outside;
+    };
+    struct Candidate
+    {
+      int point;
+      double distance;
+      int commonTones;
+      Candidate() : point(-1), distance(DBL_MAX), commonTones(0)
+      {
+      }
+    };
+    int voiceN;
+    int root;
+    std::vector<Chord> voicings;
+    std::vector<double> pitches;
+    std::vector<Node> nodes;
+    const double *point(int index) const
+    {
+      return &pitches[size_t(index) * voiceN];
+    }
+    double distance(const double *a, const double *b) const
+    {
+      double L1 = 0.0;
+      for (int voice = 0; voice < voiceN; ++voice) {
+        L1 = L1 + std::abs(b[voice] - a[voice]);
+      }
+      return L1;
+    }
+    /**
+     * Partitions points [begin, end) about the first, which becomes the
+     * vantage point: those at or within the median distance from it go
+     * inside, those at or beyond it go outside.
+     */
+    int buildNode(std::vector<int> &points, size_t begin, size_t end)
+    {
+      if (begin == end) {
+        return -1;
+      }
+      int index = int(nodes.size());
+      Node node;
+      node.point = points[begin];
+      node.threshold = 0.0;
+      node.inside = -1;
+      node.outside = -1;
+      nodes.push_back(node);
+      if (end - begin > 1) {
+        const double *vantage = point(points[begin]);
+        size_t middle = begin + 1 + (end - begin - 1) / 2;
+        std::nth_element(points.begin() + begin + 1, points.begin() + middle, points.begin() + end,
+                         [this, vantage](int a, int b) {
+                           return distance(vantage, point(a)) < distance(vantage, point(b));
+                         });
+        double threshold = distance(vantage, point(points[middle]));
+        int inside = buildNode(points, begin + 1, middle);
+        int outside = buildNode(points, middle, end);
+        nodes[index].threshold = threshold;
+        nodes[index].inside = inside;
+        nodes[index].outside = outside;
+      }
+      return index;
+    }
+    bool isBetter(const Candidate &a, const Candidate &b) const
+    {
+      if (lt_epsilon(a.distance, b.distance)) {
+        return true;
+      }
+      if (gt_epsilon(a.distance, b.distance)) {
+        return false;
+      }
+      if (a.commonTones != b.commonTones) {
+        return a.commonTones > b.commonTones;
+      }
+      return a.point < b.point;
+    }
+    void search(int index, const double *query, bool avoidParallels, Candidate &best) const
+    {
+      if (index == -1) {
+        return;
+      }
+      const Node &node = nodes[index];
+      const double *candidatePitches = point(node.point);
+      double distance_ = distance(query, candidatePitches);
+      int commonTones = 0;
+      int fifths = 0;
+      for (int voice = 0; voice < voiceN; ++voice) {
+        double interval = candidatePitches[voice] - query[voice];
+        if (eq_epsilon(interval, 0.0)) {
+          commonTones++;
+        }
+        if (eq_epsilon(interval, 7.0)) {
+          fifths++;
+        }
+      }
+      if (!avoidParallels || fifths <= 1) {
+        Candidate candidate;
+        candidate.point = node.point;
+        candidate.distance = distance_;
+        candidate.commonTones = commonTones;
+        if (best.point == -1 || isBetter(candidate, best)) {
+          best = candidate;
+        }
+      }
+      // Ties in distance are broken by other criteria, so subtrees that
+      // may hold a voicing as close as the best must still be visited.
+      double tolerance = EPSILON() * epsilonFactor();
+      if (distance_ < node.threshold) {
+        if (distance_ - node.threshold <= best.distance + tolerance) {
+          search(node.inside, query, avoidParallels, best);
+        }
+        if (node.threshold - distance_ <= best.distance + tolerance) {
+          search(node.outside, query, avoidParallels, best);
+        }
+      } else {
+        if (node.threshold - distance_ <= best.distance + tolerance) {
+          search(node.outside, query, avoidParallels, best);
+        }
+        if (distance_ - node.threshold <= best.distance + tolerance) {
+          search(node.inside, query, avoidParallels, best);
+        }
+      }
+    }
+  };
+
+  /**
+   * A thread-safe cache of VoicingIndexes for destination chords, keyed by
+   * the RP form of the destination and the range, so that the voicings of
+   * a chord that recurs in a progression are indexed only once. When the
+   * cache reaches its capacity, it is cleared.
+   */
+  class SILENCE_PUBLIC VoicingIndexCache
+  {
+  public:
+    static VoicingIndexCache &instance()
+    {
+      static VoicingIndexCache cache;
+      return cache;
+    }
+    VoicingIndexCache() : capacity(10000)
+    {
+    }
+    std::shared_ptr<const VoicingIndex> get(const Chord &destination, double range)
+    {
+      Key key(range, csound::normalize<EQUIVALENCE_RELATION_RP>(destination, OCTAVE(), 1.0));
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<Key, std::shared_ptr<const VoicingIndex> >::iterator it = indexes.find(key);
+        if (it != indexes.end()) {
+          return it->second;
+        }
+      }
+      std::shared_ptr<const VoicingIndex> index = std::make_shared<VoicingIndex>(key.second, range);
+      std::lock_guard<std::mutex> lock(mutex);
+      if (indexes.size() >= capacity) {
+        indexes.clear();
+      }
+      indexes.insert(std::make_pair(key, index));
+      return index;
+    }
+    size_t getCapacity() const
+    {
+      return capacity;
+    }
+    void setCapacity(size_t capacity_)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      capacity = capacity_;
+      indexes.clear();
+    }
+    void clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      indexes.clear();
+    }
+  protected:
+    typedef std::pair<double, Chord> Key;
+    std::mutex mutex;
+    size_t capacity;
+    std::map<Key, std::shared_ptr<const VoicingIndex> > indexes;
+  };
+
+  /**
+   * Returns the octavewise revoicing of the destination within the range
+   * that has the closest voice-leading from the source, optionally avoiding
+   * parallel fifths, using a cached VoicingIndex. Unlike
+   * voiceleadingClosestRange, which revoices the destination from the
+   * source's OP form and compares by folding voiceleadingCloser over the
+   * voicings, this searches the revoicings of the destination's own OP
+   * form and uses the total order of VoicingIndex.
+   */
+  inline SILENCE_PUBLIC Chord voiceleadingClosestIndexed(const Chord &source, const Chord &destination, double range, bool avoidParallels = false)
+  {
+    std::shared_ptr<const VoicingIndex> index = VoicingIndexCache::instance().get(destination, range);
+    return index->closest(source, avoidParallels);
+  }
+}
+#endif